@@ -2,7 +2,10 @@
 #include <csignal>
 #include <cmath>
 #include <vector>
+#include <deque>
 #include <algorithm>
+#include <cstring>
+#include <string>
 
 #include "cli_args_szilv.hpp"
 #include <mouse_event_reader.hpp>
@@ -10,7 +13,16 @@
 #include "base_geometry.hpp"
 #include "2D_triangle.hpp"
 #include "2D_line_drawer.hpp"
+#include "thread_pool.hpp"
+#include "2D_rasterizer.hpp"
+#include "2D_triangle_simd.hpp"
 #include "fps_digits.hpp"
+#include "shadow_buffer.hpp"
+#include "frame_pacer.hpp"
+#include "strip_scheduler.hpp"
+#include "profiling.hpp"
+#include "trace.hpp"
+#include "perf_counters.hpp"
 #include "tools.hpp"
 
 
@@ -27,21 +39,155 @@ const uint32_t color_black    = 0x0;
 bool keep_running = true;
 bool show_fps = false;
 bool double_buffering = false;
+bool page_flip = false;
+bool atomic = false;
+bool shadow = false;
+bool all_outputs = false;
+bool pace = false;
+uint32_t nr_of_buffers = 2;
+bool simd_fill = false;
+bool fixed_point = false;
 uint32_t nr_of_draw_workers = 2U; // the last fallback
 uint32_t buffer_slice = 10;
+bool adaptive_slices = false;
+bool pipeline = false;
+std::string profile_path;
+std::string trace_path;
 szcl::MouseEventReader * mouse_event_reader;
 szilv::DrmUtil * drmUtil;
-std::vector<szilv::LineDrawer2D *> workers;
+// time spent on drawing and on the shadow copy, printed on exit
+uint64_t stats_frames = 0;
+int64_t stats_draw_nanos = 0;
+int64_t stats_copy_nanos = 0;
+szilv::FrameProfiler * profiler = nullptr;
+// the hardware counters of every worker, indexed like the profile
+std::vector<szilv::perf_worker> * perf_workers = nullptr;
+
+// a slice that charges its time and its hardware counters to the worker of the profiler
+class ProfiledDrawTask : public szilv::DrawTask {
+    public:
+        ProfiledDrawTask(szilv::DrawWork work, uint32_t worker_base) : DrawTask(work), worker_base(worker_base),
+            pixels((uint64_t)(work.squareDefinition.x2 - work.squareDefinition.x1 + 1)
+                    * (work.squareDefinition.y2 - work.squareDefinition.y1 + 1)) {}
+        void run(uint32_t worker_id) override {
+            szilv::WorkerTimer timer(profiler, worker_base + worker_id);
+            szilv::PerfScope perf(perf_workers ? &(*perf_workers)[worker_base + worker_id] : nullptr, pixels);
+            DrawTask::run(worker_id);
+        }
+
+    private:
+        // the workers of the outputs follow each other in the profile
+        uint32_t worker_base;
+        uint64_t pixels;
+};
+
+// the fps digits of the current frame of every output, they live until all the pools are waited for
+std::deque<ProfiledDrawTask> frame_tasks;
+
+// one frame of an output from the geometry to the present. With --pipeline the next frame is prepared
+// while the workers still draw the previous one, so every output has two of them
+struct Frame {
+    Frame(szilv::TrianglePrimitive primitive) : triangle(primitive) {}
+
+    szilv::modeset_buf * buf = nullptr;
+    // where the triangle is drawn, and the index of what was drawn there last time
+    uint32_t buf_idx = 0;
+    uint32_t old_idx = 0;
+    int64_t t = 0;
+
+    szilv::Triangle2D triangle;
+    szilv::Rasterizer2D rasterizer;
+    szilv::TriangleFillSimd2D simd_rasterizer;
+    szilv::FixedRasterizer2D fixed_rasterizer;
+    std::vector<szilv::SquareDefinition> strips;
+    // the slices, built by the geometry stage, submitted later
+    std::deque<ProfiledDrawTask> tasks;
+    // what the new triangle and the old one cover together
+    szilv::SquareDefinition square = {0, 0, -1, -1};
+};
+
+// everything one output is drawn with. Every output has its own worker group and its own triangle,
+// the outputs are drawn at the same time and flip on their own vblank
+struct Output {
+    Output(szilv::modeset_dev * dev, szilv::TrianglePrimitive primitive, uint32_t nr_of_triangle_buffers)
+        : dev(dev), triangle(primitive),
+        old_triangles(nr_of_triangle_buffers, szilv::Triangle2D(primitive)),
+        old_rasterizers(nr_of_triangle_buffers, szilv::Rasterizer2D(primitive)),
+        old_fixed_rasterizers(nr_of_triangle_buffers, szilv::FixedRasterizer2D(primitive)),
+        frames(2, Frame(primitive)) {}
+
+    szilv::modeset_dev * dev;
+    uint32_t index = 0;
+    szilv::ThreadPool * pool = nullptr;
+    szilv::ShadowBuffer * shadow_buffer = nullptr;
+    // the draw target when the frames are rendered into the shadow buffer: a dumb buffer with cached memory
+    szilv::modeset_buf shadow_buf;
+    // acquired for the next frame, nullptr when the output has no free buffer this round
+    szilv::modeset_buf * next_buf = nullptr;
+
+    // where the triangle is, it moves on with every frame
+    szilv::Triangle2D triangle;
+    // what was drawn last time into each buffer, the span fill only rewrites the difference
+    std::vector<szilv::Triangle2D> old_triangles;
+    std::vector<szilv::Rasterizer2D> old_rasterizers;
+    std::vector<szilv::FixedRasterizer2D> old_fixed_rasterizers;
+    // the strips of equal cost with --adaptive-slices
+    szilv::StripScheduler strip_scheduler;
+
+    std::vector<Frame> frames;
+    // prepared but not submitted yet, and submitted but not presented yet
+    Frame * next = nullptr;
+    Frame * drawing = nullptr;
+
+    // the first worker of this output in the profile
+    uint32_t profile_worker_base = 0;
+
+    int64_t prev_t = 0;
+    szilv::FpsMeter fps_meter;
+    uint32_t fps = 0;
+    bool second_frame_after_fps_update = false;
+    uint32_t previous_nr_of_digits = 0;
+    // what the screen shows and the new frame differs in: the previous and the current triangle, the fps digits
+    szilv::SquareDefinition previous_square = {0, 0, -1, -1};
+    szilv::SquareDefinition fps_area = {0, 0, -1, -1};
+};
+std::vector<Output *> outputs;
+szilv::FramePacer * pacer = nullptr;
 
 
 /**
  *
  */
 void clean_up() {
+    if (stats_frames) {
+        std::clog << stats_frames << " frames, draw " << stats_draw_nanos / stats_frames / 1000 << " us/frame";
+        if (shadow) {
+            std::clog << ", shadow copy " << stats_copy_nanos / stats_frames / 1000 << " us/frame";
+        }
+        std::clog << std::endl;
+    }
     // join worker threads
-    while (workers.size()) {
-        delete workers.back(); // the destructor calls the thread join
-        workers.pop_back();
+    for (auto out : outputs) {
+        delete out->pool;
+        delete out->shadow_buffer;
+        delete out;
+    }
+    outputs.clear();
+    delete pacer;
+    if (perf_workers) {
+        szilv::writePerfReport(std::clog, *perf_workers);
+        delete perf_workers;
+        perf_workers = nullptr;
+    }
+    if (!trace_path.empty()) {
+        // the workers are joined, nothing records any more
+        szilv::Trace::dumpJson(trace_path.c_str());
+        trace_path.clear();
+    }
+    if (profiler) {
+        profiler->dumpJson(profile_path.c_str());
+        delete profiler;
+        profiler = nullptr;
     }
     delete mouse_event_reader;
     delete drmUtil;
@@ -61,6 +207,12 @@ void sig_handler(int signo) {
     }
 }
 
+static void profile_phase(szilv::FramePhase phase) {
+    if (profiler) {
+        profiler->phase(phase);
+    }
+}
+
 static int64_t get_nanos(void) {
     struct timespec ts;
     timespec_get(&ts, TIME_UTC);
@@ -80,34 +232,65 @@ szilv::SquareDefinition defineTheSquareContainingTheTriangles(szilv::Triangle2D
 }
 
 /**
- *
+ * the slices of the frame, the workers steal them from each other. old_estimate: what the target shows
+ * when the slices run, only the strip estimate uses it
  */
-void distribute_triangle_draws(szilv::Triangle2D * tr, szilv::SquareDefinition squareCoordinates, uint32_t color, szilv::modeset_buf * buf) {
+void build_triangle_draws(Output * out, Frame * frame, uint32_t color, szilv::modeset_buf * buf,
+        const szilv::Rasterizer2D & old_estimate) {
     uint32_t bg_color = color_black;
-    // distribute slices of the big 2D square, the triangle is inside, between worker threads
-    uint32_t slice = 0;
-    for (int32_t y=squareCoordinates.y1; y <= squareCoordinates.y2; y+=buffer_slice) {
-        szilv::SquareDefinition square_slice = {
-            squareCoordinates.x1, y, 
-            squareCoordinates.x2, std::min(y + (int32_t)buffer_slice, squareCoordinates.y2)
-        }; 
-        auto isInside = [tr](szilv::Vertex point) -> bool {
-            return tr->pointInTriangle(point);
-        };
+    szilv::Triangle2D * tr = &frame->triangle;
+    szilv::SquareDefinition squareCoordinates = frame->square;
+    if (simd_fill) {
+        frame->simd_rasterizer.setPrimitive(tr->getPrimitive());
+    } else if (fixed_point) {
+        frame->fixed_rasterizer.setPrimitive(tr->getPrimitive());
+    }
+    // the strips are estimated with the span rasterizer whatever fills them
+    if (adaptive_slices || !(simd_fill || fixed_point)) {
+        frame->rasterizer.setPrimitive(tr->getPrimitive());
+    }
+    frame->strips.clear();
+    if (adaptive_slices) {
+        // the waiting thread draws too
+        out->strip_scheduler.setNrOfStrips((out->pool->getActiveWorkers() + 1) * 4);
+        out->strip_scheduler.split(squareCoordinates, frame->rasterizer, old_estimate, frame->strips);
+    } else {
+        for (int32_t y=squareCoordinates.y1; y <= squareCoordinates.y2; y+=buffer_slice) {
+            frame->strips.push_back({
+                squareCoordinates.x1, y, 
+                squareCoordinates.x2, std::min(y + (int32_t)buffer_slice, squareCoordinates.y2)
+            });
+        }
+    }
+    // the old rasterizers of the buffer are updated by the time the slices run
+    frame->tasks.clear();
+    for (auto & square_slice : frame->strips) {
         szilv::DrawWork work = {
             color, bg_color, 
-            (void*)tr, isInside,
-            square_slice, buf->map,
-            buf->width, buf->height
+            (void*)tr, szilv::SHAPE_TRIANGLE,
+            square_slice, (uint8_t*)buf->map,
+            buf->stride, buf->width, buf->height,
+            simd_fill || fixed_point ? nullptr : &frame->rasterizer,
+            simd_fill || fixed_point ? nullptr : &out->old_rasterizers[frame->old_idx],
+            simd_fill ? &frame->simd_rasterizer : nullptr,
+            fixed_point ? &frame->fixed_rasterizer : nullptr,
+            fixed_point ? &out->old_fixed_rasterizers[frame->old_idx] : nullptr
         };
-        auto worker = workers[slice % nr_of_draw_workers];
-        worker->addWorkBlocking(work);
-        slice++;
+        frame->tasks.emplace_back(work, out->profile_worker_base);
     }
 }
 
-uint32_t previous_nr_of_digits = 0;
-void fps_counter(uint32_t fps, szilv::LineDrawer2D * worker, szilv::modeset_buf * buf) {
+void submit_frame(Output * out, Frame * frame) {
+    for (auto & task : frame->tasks) {
+        out->pool->submit(&task);
+    }
+    out->drawing = frame;
+}
+
+/**
+ * returns the area of the digits
+ */
+szilv::SquareDefinition fps_counter(Output * out, uint32_t fps, szilv::modeset_buf * buf) {
     uint32_t nr_of_digits = 0;
     uint32_t tmp = fps;
     while (tmp) {
@@ -119,7 +302,11 @@ void fps_counter(uint32_t fps, szilv::LineDrawer2D * worker, szilv::modeset_buf
     const int32_t digitWidth = 15;
     const int32_t digitHeight = 18;
 
-    uint32_t this_round_max = std::max(previous_nr_of_digits, nr_of_digits);
+    uint32_t this_round_max = std::max(out->previous_nr_of_digits, nr_of_digits);
+    szilv::SquareDefinition area = {
+        (int32_t)buf->width - (digitWidth + 3) * (int32_t)this_round_max, fpsTopOffset,
+        (int32_t)buf->width - 1, fpsTopOffset + digitHeight - 1
+    };
     for (uint32_t i = 0; i < this_round_max; i++) {
         char * digit = fps 
             ? szilv::FpsDigits::getDigit(fps % 10)
@@ -129,21 +316,108 @@ void fps_counter(uint32_t fps, szilv::LineDrawer2D * worker, szilv::modeset_buf
             left, fpsTopOffset, 
             left + digitWidth - 1, fpsTopOffset + digitHeight - 1
         }; 
-        auto isInside = [digit, left](szilv::Vertex point) -> bool {
-            uint32_t x = (uint32_t)point.x;
-            uint32_t y = (uint32_t)point.y;
-            return (bool) digit[(y - fpsTopOffset) * digitWidth + (x - left)];
-        };
         szilv::DrawWork work = {
             color_blue, color_black, 
-            (void*)digit, isInside,
-            square_slice, buf->map,
-            buf->width, buf->height
+            (void*)digit, szilv::SHAPE_MASK,
+            square_slice, (uint8_t*)buf->map,
+            buf->stride, buf->width, buf->height
         };
-        worker->addWorkBlocking(work);
+        frame_tasks.emplace_back(work, out->profile_worker_base);
+        out->pool->submit(&frame_tasks.back());
         fps /= 10; 
     }
-    previous_nr_of_digits = this_round_max;
+    out->previous_nr_of_digits = this_round_max;
+    return area;
+}
+
+/**
+ * drm_mode_rect has exclusive x2, y2
+ */
+drm_mode_rect to_damage_rect(szilv::SquareDefinition square, szilv::modeset_buf * buf) {
+    drm_mode_rect rect = {
+        std::max(square.x1, 0), std::max(square.y1, 0),
+        std::min(square.x2 + 1, (int32_t)buf->width), std::min(square.y2 + 1, (int32_t)buf->height)
+    };
+    return rect;
+}
+
+/**
+ * more workers when the frames overrun, fewer when they have headroom, on every output
+ */
+void pacer_hint(szilv::PacerHint hint, void * user_data) {
+    for (auto out : outputs) {
+        uint32_t active = out->pool->getActiveWorkers();
+        out->pool->setActiveWorkers(hint == szilv::PACER_OVERRUN ? active + 1 : active - 1);
+    }
+    std::clog << (hint == szilv::PACER_OVERRUN ? "frames overrun" : "frames have headroom") << ", "
+        << outputs[0]->pool->getActiveWorkers() << " workers per output" << std::endl;
+}
+
+/**
+ * a flip completed, the buffer that was on the screen before is free
+ */
+void trace_flip(szilv::modeset_buf * buf, void * user_data) {
+    for (auto out : outputs) {
+        if (buf >= out->dev->bufs && buf < out->dev->bufs + out->dev->nr_of_bufs) {
+            szilv::Trace::instant("flip", "drm", "output", out->index);
+        }
+    }
+}
+
+szilv::SquareDefinition square_union(szilv::SquareDefinition a, szilv::SquareDefinition b) {
+    return { std::min(a.x1, b.x1), std::min(a.y1, b.y1), std::max(a.x2, b.x2), std::max(a.y2, b.y2) };
+}
+
+/**
+ * waits for the frame in flight once, the workers still read the old triangle of its buffer
+ */
+void wait_frame(Output * out) {
+    Frame * frame = out->drawing;
+    szilv::modeset_buf * target = shadow ? &out->shadow_buf : frame->buf;
+    profile_phase(szilv::PHASE_SYNC_WAIT);
+    out->pool->wait();
+
+    // update the old Triangle
+    out->old_triangles[frame->old_idx].setPrimitive(frame->triangle.getPrimitive());
+    out->old_rasterizers[frame->old_idx].setPrimitive(frame->triangle.getPrimitive());
+    out->old_fixed_rasterizers[frame->old_idx].setPrimitive(frame->triangle.getPrimitive());
+
+    if (show_fps && (out->second_frame_after_fps_update || out->fps_meter.update(frame->t))) {
+        if (!out->second_frame_after_fps_update) {
+            out->fps = (uint32_t)std::lround(out->fps_meter.getFps());
+        }
+        profile_phase(szilv::PHASE_RASTER);
+        out->fps_area = fps_counter(out, out->fps, target);
+        profile_phase(szilv::PHASE_SYNC_WAIT);
+        out->pool->wait();
+        out->second_frame_after_fps_update = !out->second_frame_after_fps_update;
+        if (shadow) {
+            out->shadow_buffer->addDirty(out->fps_area);
+        }
+    }
+}
+
+void present_frame(Output * out) {
+    Frame * frame = out->drawing;
+    szilv::modeset_buf * buf = frame->buf;
+    if (shadow) {
+        out->shadow_buffer->addDirty(frame->square);
+        out->shadow_buffer->flush(frame->buf_idx, buf->map, buf->stride);
+    }
+
+    if (double_buffering) {
+        szilv::SquareDefinition damage = out->previous_square.x2 < 0
+            ? frame->square
+            : square_union(frame->square, out->previous_square);
+        if (out->fps_area.x2 >= 0) {
+            damage = square_union(damage, out->fps_area);
+        }
+        drm_mode_rect damage_rect = to_damage_rect(damage, buf);
+        szilv::TraceScope trace("present", "drm", "output", out->index);
+        drmUtil->present(buf, &damage_rect);
+    }
+    out->previous_square = frame->square;
+    out->fps_meter.frame();
 }
 
 /**
@@ -161,7 +435,32 @@ int main(int argc, char **argv) {
         cliArgs.addOptionInteger("s,triangle-side-size", "The size of the triangle side.", 400);
         cliArgs.addOptionInteger("w,parallel-draw-workers", "The number of parallel draw workers. Default is the number of available CPUs.", std::max(2U, tl::Tools::nr_of_cpus()));
         cliArgs.addOptionInteger("buffer-slice", "The size of buffer slice we are pushing to one draw worker once.", 10);
+        cliArgs.addOptionBoolean("adaptive-slices", "Instead of --buffer-slice rows, split the frame into strips of equal "
+                "estimated cost from the spans of the triangles, about 4 per worker", false);
+        cliArgs.addOptionBoolean("pipeline", "Prepare the geometry and the slices of the next frame while the workers draw "
+                "the current one, at most one frame more latency. Needs a single buffer or 3 or more --buffers; with page "
+                "flips the next buffer is taken at the vblank that frees it, while the workers still draw. The profile "
+                "has no per worker times then", false);
         cliArgs.addOptionBoolean("double-buffering", "Use double buffer from the DRM library", false);
+        cliArgs.addOptionBoolean("page-flip", "Double buffering with vblank synchronized page flips instead of a modeset per frame", false);
+        cliArgs.addOptionBoolean("atomic", "Page flips with nonblocking atomic commits, passing the changed area as FB_DAMAGE_CLIPS", false);
+        cliArgs.addOptionInteger("buffers", "The number of buffers with double buffering or page flips, 2-4. With 3 or more the drawing does not wait for the vblank.", 2);
+        cliArgs.addOptionString("mode", "The display mode: first, preferred, max-refresh, WxH or WxH@Hz, e.g. 1920x1080@60. "
+                "A lower resolution than the native one is the cheapest way to a higher frame rate.", "first");
+        cliArgs.addOptionBoolean("list-modes", "Prints the modes of the outputs and exits", false);
+        cliArgs.addOptionBoolean("all-outputs", "Drive every connected monitor, each with its own worker group, flipping on its own vblank", false);
+        cliArgs.addOptionBoolean("pace", "Limit the frame rate to the refresh rate of the display or to --target-fps, "
+                "sleeping between the frames. The number of workers follows the load", false);
+        cliArgs.addOptionInteger("target-fps", "The frame rate of --pace, 0: the refresh rate of the first output", 0);
+        cliArgs.addOptionBoolean("shadow", "Render into a shadow buffer in cached memory and copy only the changed rows to the dumb buffer", false);
+        cliArgs.addOptionBoolean("simd-fill", "Evaluate the triangle coverage per pixel with the AVX2/SSE4.1 kernel instead of the span rasterizer", false);
+        cliArgs.addOptionBoolean("fixed-point", "Rasterize with vertices snapped to 28.4 fixed point and integer edge functions", false);
+        cliArgs.addOptionString("profile", "Record the phase timings of every frame and write their percentiles as JSON "
+                "to this file on exit and on SIGUSR1", "");
+        cliArgs.addOptionString("trace", "Record the slices of the workers, the presents and the flips as a Chrome trace "
+                "(chrome://tracing, ui.perfetto.dev), written to this file on exit", "");
+        cliArgs.addOptionBoolean("perf-counters", "Count cycles, instructions, cache and branch misses of every worker "
+                "in the slices with perf_event_open, IPC and misses per pixel are printed on exit", false);
         cliArgs.addOptionBoolean("show-fps", "Show custom built FPS counter in the upper right corner", false);
         cliArgs.addOptionHelp("h,help", "Prints this help message.");
         cliArgs.parseArguments(argc, argv);
@@ -179,22 +478,61 @@ int main(int argc, char **argv) {
 
     show_fps = cliArgs.has("show-fps") && cliArgs.getOptionBoolean("show-fps");
     nr_of_draw_workers = cliArgs.has("w") ? cliArgs.getOptionInteger("w") : std::max(2U, tl::Tools::nr_of_cpus());
-    double_buffering = cliArgs.has("double-buffering") && cliArgs.getOptionBoolean("double-buffering");
+    atomic = cliArgs.has("atomic") && cliArgs.getOptionBoolean("atomic");
+    page_flip = atomic || (cliArgs.has("page-flip") && cliArgs.getOptionBoolean("page-flip"));
+    double_buffering = page_flip || (cliArgs.has("double-buffering") && cliArgs.getOptionBoolean("double-buffering"));
+    nr_of_buffers = cliArgs.has("buffers") ? cliArgs.getOptionInteger("buffers") : nr_of_buffers;
+    nr_of_buffers = std::min(szilv::MODESET_MAX_BUFFERS, std::max(szilv::MODESET_MIN_BUFFERS, nr_of_buffers));
+    shadow = cliArgs.has("shadow") && cliArgs.getOptionBoolean("shadow");
+    all_outputs = cliArgs.has("all-outputs") && cliArgs.getOptionBoolean("all-outputs");
+    pace = cliArgs.has("pace") && cliArgs.getOptionBoolean("pace");
+    simd_fill = cliArgs.has("simd-fill") && cliArgs.getOptionBoolean("simd-fill");
+    fixed_point = !simd_fill && cliArgs.has("fixed-point") && cliArgs.getOptionBoolean("fixed-point");
+    if (simd_fill) {
+        std::clog << "simd fill kernel: " << szilv::TriangleFillSimd2D::getPathName() << std::endl;
+    }
     buffer_slice = cliArgs.has("buffer-slice") ? cliArgs.getOptionInteger("buffer-slice") : buffer_slice;
+    adaptive_slices = cliArgs.has("adaptive-slices") && cliArgs.getOptionBoolean("adaptive-slices");
+    pipeline = cliArgs.has("pipeline") && cliArgs.getOptionBoolean("pipeline");
+    profile_path = cliArgs.has("profile") ? cliArgs.getOptionString("profile") : "";
+    trace_path = cliArgs.has("trace") ? cliArgs.getOptionString("trace") : "";
 
     // initialize the drm device
     std::string drm_card_name = cliArgs.getOptionString("dri-device");
-    drmUtil = new szilv::DrmUtil(drm_card_name.c_str());
-    int32_t response = drmUtil->initDrmDev();
+    drmUtil = new szilv::DrmUtil(drm_card_name.c_str(), page_flip, nr_of_buffers, atomic, all_outputs);
+    szilv::mode_spec mode;
+    int32_t response = szilv::DrmUtil::parseModeSpec(
+            cliArgs.has("mode") ? cliArgs.getOptionString("mode").c_str() : "first", &mode);
+    if (response) {
+        return response;
+    }
+    drmUtil->setModeSpec(mode);
+    response = drmUtil->initDrmDev();
     if (response) {
         return response;
     }
-    szilv::modeset_buf * buf = &drmUtil->mdev->bufs[0];
+    uint32_t nr_of_outputs = drmUtil->getNrOfOutputs();
+
+    if (cliArgs.has("list-modes") && cliArgs.getOptionBoolean("list-modes")) {
+        for (uint32_t i = 0; i < nr_of_outputs; i++) {
+            szilv::modeset_dev * dev = drmUtil->getOutput(i);
+            std::cout << "output " << i << ", connector " << dev->conn << ":" << std::endl;
+            for (auto & m : drmUtil->getModes(dev)) {
+                bool current = !memcmp(&m, &dev->mode, sizeof(m));
+                std::cout << (current ? "  * " : "    ") << m.hdisplay << "x" << m.vdisplay << "@"
+                    << szilv::DrmUtil::getRefreshRate(&m)
+                    << (m.type & DRM_MODE_TYPE_PREFERRED ? " preferred" : "")
+                    << (m.flags & DRM_MODE_FLAG_INTERLACE ? " interlaced" : "") << std::endl;
+            }
+        }
+        delete drmUtil;
+        return 0;
+    }
 
-    // initialize the MouseEventReader
+    // initialize the MouseEventReader, the mouse moves on the first output, the others follow it scaled
     std::string input_device_name = cliArgs.getOptionString("mouse-input-device");
-    uint32_t max_x = (&drmUtil->mdev->bufs[0])->width;
-    uint32_t max_y = (&drmUtil->mdev->bufs[0])->height;
+    uint32_t max_x = szilv::DrmUtil::getWidth(drmUtil->mdev);
+    uint32_t max_y = szilv::DrmUtil::getHeight(drmUtil->mdev);
     mouse_event_reader = new szcl::MouseEventReader(
             input_device_name.c_str(),
             max_x, max_y);
@@ -210,91 +548,188 @@ int main(int argc, char **argv) {
     const double sin60 = sin(60 * M_PI / 180);
     const double cos60 = cos(60 * M_PI / 180);
     double trg_height = trg_side * sin60;
+    szilv::TrianglePrimitive initial_triangle = {
+        { trg_offset_x + trg_side * cos60,      trg_offset_y,               0 },
+        { trg_offset_x,                         trg_offset_y + trg_height,  0 },
+        { trg_offset_x + trg_side,              trg_offset_y + trg_height,  0 }
+    };
 
-    // current
-    szilv::Triangle2D triangle = szilv::Triangle2D(
-                    { trg_offset_x + trg_side * cos60,      trg_offset_y,               0 },
-                    { trg_offset_x,                         trg_offset_y + trg_height,  0 },
-                    { trg_offset_x + trg_side,              trg_offset_y + trg_height,  0 }
-                    );
-    szilv::Triangle2D * new_triangle = &triangle;
-
-    // old
-    uint32_t nr_of_triangle_buffers = double_buffering ? 2 : 1;
-    std::vector<szilv::Triangle2D> old_triangles(nr_of_triangle_buffers, new szilv::Triangle2D(
-                { trg_offset_x + trg_side * cos60,      trg_offset_y,               0 },
-                { trg_offset_x,                         trg_offset_y + trg_height,  0 },
-                { trg_offset_x + trg_side,              trg_offset_y + trg_height,  0 }
-                )
-            );
-    szilv::Triangle2D * old_triangle = nullptr;
-
-    uint32_t max_radius = new_triangle->getRadiusOfTheOuterCircle();
-
-    // start worker threads
-    for ( uint32_t i = 0; i < nr_of_draw_workers; i++) {
-        workers.push_back(new szilv::LineDrawer2D(i, buf->width, buf->height));
-    }
-
-    int64_t prev_t = get_nanos();
-    uint64_t counter = 0;
-    uint64_t counter_fps = 0;
-    uint32_t fps = 0;
-    bool second_frame_after_fps_update = false;
-    auto fps_draw_worker = workers[nr_of_draw_workers - 1];
-    uint64_t previous_fps_changed_at = get_nanos();
-    bool keep_fps_one_more_frame = true;
-
-    while (keep_running) {
-        int64_t t = get_nanos();
-        int64_t t_diff = t - prev_t;
-        prev_t = t;
-        double angle = (double)(t_diff) * 0.000000001;
+    // old triangles: one per buffer, the shadow buffer always holds the previous frame
+    uint32_t nr_of_triangle_buffers = double_buffering && !shadow ? nr_of_buffers : 1;
+    // the workers are shared out among the outputs
+    uint32_t workers_per_output = std::max(1U, nr_of_draw_workers / nr_of_outputs);
+    int64_t start_t = get_nanos();
+    for (uint32_t i = 0; i < nr_of_outputs; i++) {
+        szilv::modeset_dev * dev = drmUtil->getOutput(i);
+        Output * out = new Output(dev, initial_triangle, nr_of_triangle_buffers);
+        out->index = i;
+        outputs.push_back(out);
+        out->shadow_buf = dev->bufs[0];
+        if (shadow) {
+            out->shadow_buffer = new szilv::ShadowBuffer(dev->bufs[0].width, dev->bufs[0].height,
+                    dev->bufs[0].stride, dev->nr_of_bufs);
+            response = out->shadow_buffer->init();
+            if (response) {
+                clean_up();
+                return response;
+            }
+            out->shadow_buf.map = out->shadow_buffer->map;
+        }
+        // start worker threads
+        out->pool = new szilv::ThreadPool(workers_per_output);
+        out->prev_t = start_t;
+        out->fps_meter.update(start_t);
+        // the submitting thread helps in wait() as worker workers_per_output
+        out->profile_worker_base = i * (workers_per_output + 1);
+    }
 
-        uint32_t buf_idx = double_buffering ? drmUtil->mdev->front_buf ^ 1 : 0;
-        buf = &drmUtil->mdev->bufs[buf_idx];
-        old_triangle = &old_triangles[buf_idx];
+    if (!trace_path.empty()) {
+        szilv::Trace::start();
+        szilv::Trace::setThreadName("render");
+        drmUtil->setBufferFreeCallback(trace_flip, nullptr);
+    }
+    if (cliArgs.has("perf-counters") && cliArgs.getOptionBoolean("perf-counters")) {
+        perf_workers = new std::vector<szilv::perf_worker>(nr_of_outputs * (workers_per_output + 1));
+    }
+    if (!profile_path.empty()) {
+        // the slices of a pipelined frame run across endFrame, their worker times would land in the next frame
+        profiler = new szilv::FrameProfiler(pipeline ? 0 : nr_of_outputs * (workers_per_output + 1));
+        profiler->setDumpPath(profile_path.c_str());
+        szilv::FrameProfiler::installSignalHandler();
+    }
 
-        // current mouse position
-        auto mouse_position = mouse_event_reader->getMousePosition();
-        szilv::Vertex new_center = {
-            1.0 * std::min(std::max(mouse_position.x, max_radius), buf->width - max_radius),
-            1.0 * std::min(std::max(mouse_position.y, max_radius), buf->height - max_radius),
-            0
-        };
+    uint32_t max_radius = outputs[0]->triangle.getRadiusOfTheOuterCircle();
 
-        // translate the Triangle
-        new_triangle->translateToNewCenter(new_center);
+    if (pace) {
+        uint32_t target_fps = cliArgs.has("target-fps") ? cliArgs.getOptionInteger("target-fps") : 0;
+        pacer = new szilv::FramePacer(target_fps ? target_fps : szilv::DrmUtil::getRefreshRate(drmUtil->mdev));
+        pacer->setHintCallback(pacer_hint, nullptr);
+    }
 
-        // rotate the Triangle
-        new_triangle->rotateAroundTheCenter(angle);
+    while (keep_running) {
+        // a buffer that is neither on the screen nor waiting for it, the previous frames are scanned out
+        // meanwhile. An output without one is skipped this round, the others do not wait for its vblank
+        bool any_output = false;
+        bool any_drawing = false;
+        bool any_flip_pending = false;
+        for (auto out : outputs) {
+            out->next_buf = double_buffering ? drmUtil->acquire(out->dev, false) : &out->dev->bufs[0];
+            if (!out->next_buf && out->drawing && szilv::DrmUtil::isFlipPending(out->dev)) {
+                // --pipeline with page flips: the screen, the flip and the frame in flight hold a buffer each.
+                // The workers keep drawing while this waits for the vblank that frees the oldest one
+                out->next_buf = drmUtil->acquire(out->dev, true);
+            }
+            any_output = any_output || out->next_buf;
+            any_drawing = any_drawing || out->drawing;
+            any_flip_pending = any_flip_pending || szilv::DrmUtil::isFlipPending(out->dev);
+        }
+        if (!any_output && !any_drawing) {
+            // nothing on the way to the screen, no buffer will get free
+            if (!any_flip_pending || drmUtil->handleEvents(-1)) {
+                break;
+            }
+            continue;
+        }
+        int64_t t_draw = get_nanos();
+        if (pacer) {
+            pacer->beginFrame();
+        }
+        if (profiler) {
+            profiler->beginFrame();
+        }
 
-        szilv::SquareDefinition squareCoordinates = defineTheSquareContainingTheTriangles(new_triangle, old_triangle);
-        distribute_triangle_draws(new_triangle, squareCoordinates, color_white, buf);
+        // current mouse position
+        auto mouse_position = mouse_event_reader->getMousePosition();
 
-        // update the old Triangle
-        old_triangle->setPrimitive(new_triangle->getPrimitive());
+        // the geometry and the slices of the next frame of every output. With --pipeline the workers
+        // are still drawing the previous frame meanwhile
+        profile_phase(szilv::PHASE_GEOMETRY);
+        for (auto out : outputs) {
+            if (!out->next_buf) {
+                continue;
+            }
+            szilv::modeset_buf * buf = out->next_buf;
+            Frame * frame = out->drawing == &out->frames[0] ? &out->frames[1] : &out->frames[0];
+            frame->buf = buf;
+            frame->t = get_nanos();
+            double angle = (double)(frame->t - out->prev_t) * 0.000000001;
+            out->prev_t = frame->t;
+
+            frame->buf_idx = buf - out->dev->bufs;
+            frame->old_idx = shadow ? 0 : frame->buf_idx;
+            szilv::modeset_buf * target = shadow ? &out->shadow_buf : buf;
+
+            szilv::Vertex new_center = {
+                1.0 * std::min(std::max(mouse_position.x * buf->width / max_x, max_radius), buf->width - max_radius),
+                1.0 * std::min(std::max(mouse_position.y * buf->height / max_y, max_radius), buf->height - max_radius),
+                0
+            };
+
+            // translate the Triangle
+            out->triangle.translateToNewCenter(new_center);
+
+            // rotate the Triangle
+            out->triangle.rotateAroundTheCenter(angle);
+            frame->triangle.setPrimitive(out->triangle.getPrimitive());
+
+            // the frame in flight still goes into the same target when there is one: the shadow buffer,
+            // the single buffer. The slices run after it, they see what it draws
+            bool after_drawing = out->drawing && out->drawing->old_idx == frame->old_idx;
+            frame->square = defineTheSquareContainingTheTriangles(&frame->triangle,
+                    after_drawing ? &out->drawing->triangle : &out->old_triangles[frame->old_idx]);
+            build_triangle_draws(out, frame, color_white, target,
+                    after_drawing ? out->drawing->rasterizer : out->old_rasterizers[frame->old_idx]);
+            out->next = frame;
+        }
 
-        if (show_fps && (previous_fps_changed_at < t - NANO_TO_SEC_CONV || second_frame_after_fps_update)) {
-            if (!second_frame_after_fps_update) {
-                fps = counter - counter_fps;
-                counter_fps = counter;
-                previous_fps_changed_at = t;
+        // without --pipeline the frame in flight is the one just prepared
+        for (auto out : outputs) {
+            if (!pipeline && out->next) {
+                profile_phase(szilv::PHASE_RASTER);
+                submit_frame(out, out->next);
+                out->next = nullptr;
+            }
+        }
+        for (auto out : outputs) {
+            if (out->drawing) {
+                wait_frame(out);
+            }
+        }
+        frame_tasks.clear();
+        int64_t t_drawn = get_nanos();
+        stats_draw_nanos += t_drawn - t_draw;
+
+        profile_phase(szilv::PHASE_PRESENT);
+        for (auto out : outputs) {
+            if (out->drawing) {
+                present_frame(out);
+                out->drawing = nullptr;
             }
-            fps_counter(fps, fps_draw_worker, buf);
-            second_frame_after_fps_update = !second_frame_after_fps_update;
+        }
+        if (shadow) {
+            stats_copy_nanos += get_nanos() - t_drawn;
         }
 
-        if (double_buffering) {
-            // swap buffers
-            drmUtil->swap_buffers();
+        // the next frames start after the present: the target is free and the old triangles are updated
+        profile_phase(szilv::PHASE_RASTER);
+        for (auto out : outputs) {
+            if (out->next) {
+                submit_frame(out, out->next);
+                out->next = nullptr;
+            }
         }
 
-        counter++;
+        stats_frames++;
+        if (profiler) {
+            // the pacing sleep is not part of the frame
+            profiler->endFrame();
+        }
+        if (pacer) {
+            pacer->waitForNextFrame();
+        }
     }
 
     clean_up();
 
     return 0;
 }
-
@@ -0,0 +1,152 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "cli_args_szilv.hpp"
+#include "offscreen.hpp"
+#include "base_geometry.hpp"
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+#include "mesh_3D.hpp"
+#include "3D_renderer.hpp"
+#include "tools.hpp"
+
+
+#define NANO_TO_SEC_CONV 1000000000L
+
+
+const uint32_t color_mesh     = 0x40C0FF;
+const uint32_t color_black    = 0x0;
+
+
+static int64_t get_nanos(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (int64_t)ts.tv_sec * NANO_TO_SEC_CONV + ts.tv_nsec;
+}
+
+/**
+ * nearest rank percentile of a sorted vector
+ */
+int64_t percentile(const std::vector<int64_t> & sorted, double p) {
+    size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(sorted.size() - 1, rank ? rank - 1 : 0)];
+}
+
+/**
+ *
+ */
+int main(int argc, char **argv) {
+    // argument parser
+    szcl::CliArgsSzilv cliArgs("draw_mesh_offscreen", "This program spins a torus mesh through the software 3D "
+            "pipeline (transform, near plane clipping, perspective divide, viewport, depth buffer) for a fixed number "
+            "of frames into an offscreen buffer in memory and reports the frame rate and the frame latency "
+            "percentiles. It needs no display, GPU or input device.\n"
+            "Author Szilveszter Zsigmond.");
+
+    try {
+        cliArgs.addOptionInteger("n,frames", "The number of measured frames.", 1000);
+        cliArgs.addOptionInteger("warm-up-frames", "Frames drawn before the measurement starts.", 10);
+        cliArgs.addOptionInteger("width", "The width of the offscreen buffer.", 1920);
+        cliArgs.addOptionInteger("height", "The height of the offscreen buffer.", 1080);
+        cliArgs.addOptionInteger("w,parallel-draw-workers", "The number of parallel draw workers. Default is the number of available CPUs.", std::max(2U, tl::Tools::nr_of_cpus()));
+        cliArgs.addOptionInteger("strip-rows", "The rows of one raster task.", 16);
+        cliArgs.addOptionInteger("rings", "Segments of the torus around its axis.", 64);
+        cliArgs.addOptionInteger("sides", "Segments of the torus around its tube, the mesh has 2 * rings * sides triangles.", 32);
+        cliArgs.addOptionInteger("camera-distance", "The distance of the camera from the center of the torus in tenths of its radius. "
+                "Around 10 the tumbling tube sweeps through the camera and gets clipped by the near plane.", 40);
+        cliArgs.addOptionBoolean("no-culling", "Draw the back faces too, the depth test hides them", false);
+        cliArgs.addOptionHelp("h,help", "Prints this help message.");
+        cliArgs.parseArguments(argc, argv);
+    } catch (szcl::CliArgsSzilvException& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return -1;
+    }
+    if (cliArgs.isHelp()) {
+        std::cout << cliArgs.getHelpDisplay() << std::endl;
+        return 0;
+    }
+
+    uint32_t nr_of_frames = cliArgs.has("n") ? cliArgs.getOptionInteger("n") : 1000;
+    nr_of_frames = std::max(1U, nr_of_frames);
+    const uint32_t nr_of_warm_up_frames = cliArgs.has("warm-up-frames") ? cliArgs.getOptionInteger("warm-up-frames") : 10;
+    const uint32_t width = cliArgs.has("width") ? cliArgs.getOptionInteger("width") : 1920;
+    const uint32_t height = cliArgs.has("height") ? cliArgs.getOptionInteger("height") : 1080;
+    uint32_t nr_of_draw_workers = cliArgs.has("w") ? cliArgs.getOptionInteger("w") : std::max(2U, tl::Tools::nr_of_cpus());
+    const uint32_t strip_rows = cliArgs.has("strip-rows") ? cliArgs.getOptionInteger("strip-rows") : 16;
+    uint32_t rings = cliArgs.has("rings") ? cliArgs.getOptionInteger("rings") : 64;
+    rings = std::max(3U, rings);
+    uint32_t sides = cliArgs.has("sides") ? cliArgs.getOptionInteger("sides") : 32;
+    sides = std::max(3U, sides);
+    const double camera_distance = (cliArgs.has("camera-distance") ? cliArgs.getOptionInteger("camera-distance") : 40) / 10.0;
+    bool culling = !(cliArgs.has("no-culling") && cliArgs.getOptionBoolean("no-culling"));
+
+    // initialize the offscreen target
+    szilv::OffscreenTarget offscreen(width, height);
+    int32_t response = offscreen.initDev();
+    if (response) {
+        return response;
+    }
+    szilv::offscreen_buf * buf = &offscreen.mdev->bufs[0];
+
+    // the torus around the z axis, seen from the +z side
+    szilv::Mesh3D mesh = szilv::Mesh3D::torus(1.0, 0.4, rings, sides, color_mesh);
+    const szilv::Mat4 view_projection = szilv::Matrix::multiply(
+            szilv::Matrix::perspective(60 * M_PI / 180, (double)width / height, 0.1, 100),
+            szilv::Matrix::lookAt({ 0, 0, camera_distance }, { 0, 0, 0 }, { 0, 1, 0 }));
+
+    // start worker threads
+    szilv::ThreadPool * pool = new szilv::ThreadPool(nr_of_draw_workers);
+    szilv::Renderer3D renderer(pool, width, height, strip_rows);
+    renderer.setCulling(culling);
+    renderer.setBackground(color_black);
+    renderer.setLight({ 0.3, 0.6, 1.0 });
+
+    // 1 radian per 60 frames around y and a slower tumble around x, the same path every run
+    const double angle_per_frame = 1.0 / 60;
+
+    std::vector<int64_t> latencies;
+    latencies.reserve(nr_of_frames);
+    uint64_t drawn_triangles = 0;
+    uint64_t clipped_triangles = 0;
+    int64_t measure_start = 0;
+
+    for (uint32_t frame = 0; frame < nr_of_warm_up_frames + nr_of_frames; frame++) {
+        if (frame == nr_of_warm_up_frames) {
+            measure_start = get_nanos();
+        }
+        int64_t frame_start = get_nanos();
+
+        double t = frame * angle_per_frame;
+        szilv::Mat4 model = szilv::Matrix::multiply(szilv::Matrix::rotationY(t), szilv::Matrix::rotationX(t * 0.7));
+        renderer.render(mesh, model, view_projection, (uint8_t*)buf->map, buf->stride);
+
+        if (frame >= nr_of_warm_up_frames) {
+            latencies.push_back(get_nanos() - frame_start);
+            drawn_triangles += renderer.getNrOfDrawnTriangles();
+            clipped_triangles += renderer.getNrOfClippedTriangles();
+        }
+    }
+    int64_t measured = get_nanos() - measure_start;
+    delete pool;
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "mesh:         torus, " << mesh.getNrOfTriangles() << " triangles, " << mesh.getNrOfVertices()
+        << " vertices" << (culling ? ", back faces culled" : "") << std::endl;
+    std::cout << "buffer:       " << width << "x" << height << ", stride " << buf->stride << ", 32 bit float depth" << std::endl;
+    std::cout << "workers:      " << nr_of_draw_workers << ", strip " << strip_rows << " rows" << std::endl;
+    std::cout << "frames:       " << nr_of_frames << " in " << (double)measured / NANO_TO_SEC_CONV << " s" << std::endl;
+    std::cout << "frames/s:     " << nr_of_frames * (double)NANO_TO_SEC_CONV / measured << std::endl;
+    std::cout << "triangles:    " << drawn_triangles / nr_of_frames << " drawn, "
+        << clipped_triangles / nr_of_frames << " near clipped per frame" << std::endl;
+    std::cout << "latency us:   p50 " << percentile(latencies, 50) / 1000.0
+        << "  p95 " << percentile(latencies, 95) / 1000.0
+        << "  p99 " << percentile(latencies, 99) / 1000.0
+        << "  max " << latencies.back() / 1000.0 << std::endl;
+    std::cout << "checksum:     " << std::hex << szilv::OffscreenTarget::checksum(buf) << std::dec << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+#include "cli_args_szilv.hpp"
+#include "offscreen.hpp"
+#include "base_geometry.hpp"
+#include "2D_triangle.hpp"
+#include "2D_line_drawer.hpp"
+#include "2D_rasterizer.hpp"
+#include "2D_triangle_simd.hpp"
+#include "thread_pool.hpp"
+#include "tools.hpp"
+
+
+#define NANO_TO_SEC_CONV 1000000000L
+
+
+const uint32_t color_white    = 0xFFFFFF;
+const uint32_t color_black    = 0x0;
+
+bool simd_fill = false;
+bool fixed_point = false;
+uint32_t buffer_slice = 10;
+szilv::ThreadPool * pool;
+// the slices of the current frame, they live until pool->wait() returns
+std::deque<szilv::DrawTask> frame_tasks;
+szilv::Rasterizer2D rasterizer;
+szilv::TriangleFillSimd2D simd_rasterizer;
+szilv::FixedRasterizer2D fixed_rasterizer;
+
+
+static int64_t get_nanos(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (int64_t)ts.tv_sec * NANO_TO_SEC_CONV + ts.tv_nsec;
+}
+
+szilv::SquareDefinition defineTheSquareContainingTheTriangles(szilv::Triangle2D * tr1, szilv::Triangle2D * tr2) {
+    // find a square the two triangle fit inside
+    auto prmt1 = tr1->getPrimitive();
+    auto prmt2 = tr2->getPrimitive();
+    return {
+        (int32_t) std::min({prmt1.p1.x, prmt1.p2.x, prmt1.p3.x, prmt2.p1.x, prmt2.p2.x, prmt2.p3.x}),
+        (int32_t) std::min({prmt1.p1.y, prmt1.p2.y, prmt1.p3.y, prmt2.p1.y, prmt2.p2.y, prmt2.p3.y}),
+        (int32_t) std::max({prmt1.p1.x, prmt1.p2.x, prmt1.p3.x, prmt2.p1.x, prmt2.p2.x, prmt2.p3.x}),
+        (int32_t) std::max({prmt1.p1.y, prmt1.p2.y, prmt1.p3.y, prmt2.p1.y, prmt2.p2.y, prmt2.p3.y}),
+    };
+}
+
+/**
+ *
+ */
+void distribute_triangle_draws(szilv::Triangle2D * tr, szilv::SquareDefinition squareCoordinates, uint32_t color, szilv::offscreen_buf * buf,
+        szilv::Rasterizer2D * old_rasterizer, szilv::FixedRasterizer2D * old_fixed_rasterizer) {
+    uint32_t bg_color = color_black;
+    // submit slices of the big 2D square, the triangle is inside, the workers steal them from each other
+    if (simd_fill) {
+        simd_rasterizer.setPrimitive(tr->getPrimitive());
+    } else if (fixed_point) {
+        fixed_rasterizer.setPrimitive(tr->getPrimitive());
+    } else {
+        rasterizer.setPrimitive(tr->getPrimitive());
+    }
+    for (int32_t y=squareCoordinates.y1; y <= squareCoordinates.y2; y+=buffer_slice) {
+        szilv::SquareDefinition square_slice = {
+            squareCoordinates.x1, y,
+            squareCoordinates.x2, std::min(y + (int32_t)buffer_slice, squareCoordinates.y2)
+        };
+        szilv::DrawWork work = {
+            color, bg_color,
+            (void*)tr, szilv::SHAPE_TRIANGLE,
+            square_slice, (uint8_t*)buf->map,
+            buf->stride, buf->width, buf->height,
+            simd_fill || fixed_point ? nullptr : &rasterizer,
+            simd_fill || fixed_point ? nullptr : old_rasterizer,
+            simd_fill ? &simd_rasterizer : nullptr,
+            fixed_point ? &fixed_rasterizer : nullptr,
+            fixed_point ? old_fixed_rasterizer : nullptr
+        };
+        frame_tasks.emplace_back(work);
+        pool->submit(&frame_tasks.back());
+    }
+}
+
+/**
+ * nearest rank percentile of a sorted vector
+ */
+int64_t percentile(const std::vector<int64_t> & sorted, double p) {
+    size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(sorted.size() - 1, rank ? rank - 1 : 0)];
+}
+
+/**
+ *
+ */
+int main(int argc, char **argv) {
+    // argument parser
+    szcl::CliArgsSzilv cliArgs("draw_triangle_offscreen", "This program runs the rotating triangle workload of the DRM "
+            "programs for a fixed number of frames into an offscreen buffer in memory and reports the frame rate, "
+            "the cost per pixel and the frame latency percentiles. It needs no display, GPU or input device.\n"
+            "Author Szilveszter Zsigmond.");
+
+    try {
+        cliArgs.addOptionInteger("n,frames", "The number of measured frames.", 1000);
+        cliArgs.addOptionInteger("warm-up-frames", "Frames drawn before the measurement starts.", 10);
+        cliArgs.addOptionInteger("width", "The width of the offscreen buffer.", 1920);
+        cliArgs.addOptionInteger("height", "The height of the offscreen buffer.", 1080);
+        cliArgs.addOptionInteger("s,triangle-side-size", "The size of the triangle side.", 400);
+        cliArgs.addOptionInteger("w,parallel-draw-workers", "The number of parallel draw workers. Default is the number of available CPUs.", std::max(2U, tl::Tools::nr_of_cpus()));
+        cliArgs.addOptionInteger("buffer-slice", "The size of buffer slice we are pushing to one draw worker once.", 10);
+        cliArgs.addOptionBoolean("double-buffering", "Alternate between two offscreen buffers like the DRM double buffering", false);
+        cliArgs.addOptionBoolean("simd-fill", "Evaluate the triangle coverage per pixel with the AVX2/SSE4.1 kernel instead of the span rasterizer", false);
+        cliArgs.addOptionBoolean("fixed-point", "Rasterize with vertices snapped to 28.4 fixed point and integer edge functions", false);
+        cliArgs.addOptionHelp("h,help", "Prints this help message.");
+        cliArgs.parseArguments(argc, argv);
+    } catch (szcl::CliArgsSzilvException& e) {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return -1;
+    }
+    if (cliArgs.isHelp()) {
+        std::cout << cliArgs.getHelpDisplay() << std::endl;
+        return 0;
+    }
+
+    uint32_t nr_of_frames = cliArgs.has("n") ? cliArgs.getOptionInteger("n") : 1000;
+    nr_of_frames = std::max(1U, nr_of_frames);
+    const uint32_t nr_of_warm_up_frames = cliArgs.has("warm-up-frames") ? cliArgs.getOptionInteger("warm-up-frames") : 10;
+    const uint32_t width = cliArgs.has("width") ? cliArgs.getOptionInteger("width") : 1920;
+    const uint32_t height = cliArgs.has("height") ? cliArgs.getOptionInteger("height") : 1080;
+    uint32_t nr_of_draw_workers = cliArgs.has("w") ? cliArgs.getOptionInteger("w") : std::max(2U, tl::Tools::nr_of_cpus());
+    bool double_buffering = cliArgs.has("double-buffering") && cliArgs.getOptionBoolean("double-buffering");
+    simd_fill = cliArgs.has("simd-fill") && cliArgs.getOptionBoolean("simd-fill");
+    fixed_point = !simd_fill && cliArgs.has("fixed-point") && cliArgs.getOptionBoolean("fixed-point");
+    buffer_slice = cliArgs.has("buffer-slice") ? cliArgs.getOptionInteger("buffer-slice") : buffer_slice;
+
+    // initialize the offscreen target
+    szilv::OffscreenTarget offscreen(width, height);
+    int32_t response = offscreen.initDev();
+    if (response) {
+        return response;
+    }
+    szilv::offscreen_buf * buf = &offscreen.mdev->bufs[0];
+
+    // initial position and orientation of the triangle
+    const uint32_t trg_side = cliArgs.has("s") ? cliArgs.getOptionInteger("s") : 400;
+    const double sin60 = sin(60 * M_PI / 180);
+    const double cos60 = cos(60 * M_PI / 180);
+    double trg_height = trg_side * sin60;
+
+    // current
+    szilv::Triangle2D triangle = szilv::Triangle2D(
+                    { trg_side * cos60,     0,              0 },
+                    { 0,                    trg_height,     0 },
+                    { (double)trg_side,     trg_height,     0 }
+                    );
+    szilv::Triangle2D * new_triangle = &triangle;
+    uint32_t max_radius = new_triangle->getRadiusOfTheOuterCircle();
+    if (2 * max_radius >= width || 2 * max_radius >= height) {
+        std::cerr << "The triangle does not fit into " << width << "x" << height << std::endl;
+        return -1;
+    }
+
+    // old
+    uint32_t nr_of_triangle_buffers = double_buffering ? 2 : 1;
+    std::vector<szilv::Triangle2D> old_triangles(nr_of_triangle_buffers, szilv::Triangle2D(new_triangle->getPrimitive()));
+    // what was drawn last time into each buffer, the span fill only rewrites the difference
+    std::vector<szilv::Rasterizer2D> old_rasterizers(nr_of_triangle_buffers,
+            szilv::Rasterizer2D(new_triangle->getPrimitive()));
+    std::vector<szilv::FixedRasterizer2D> old_fixed_rasterizers(nr_of_triangle_buffers,
+            szilv::FixedRasterizer2D(new_triangle->getPrimitive()));
+
+    // start worker threads
+    pool = new szilv::ThreadPool(nr_of_draw_workers);
+
+    // the triangle turns 1 radian per 60 frames and its center goes around an ellipse, the same path every run
+    const double angle_per_frame = 1.0 / 60;
+    const double orbit_x = width / 2.0 - max_radius;
+    const double orbit_y = height / 2.0 - max_radius;
+
+    std::vector<int64_t> latencies;
+    latencies.reserve(nr_of_frames);
+    uint64_t drawn_pixels = 0;
+    int64_t measure_start = 0;
+
+    for (uint32_t frame = 0; frame < nr_of_warm_up_frames + nr_of_frames; frame++) {
+        if (frame == nr_of_warm_up_frames) {
+            measure_start = get_nanos();
+        }
+        int64_t frame_start = get_nanos();
+
+        uint32_t buf_idx = double_buffering ? offscreen.mdev->front_buf ^ 1 : 0;
+        buf = &offscreen.mdev->bufs[buf_idx];
+        szilv::Triangle2D * old_triangle = &old_triangles[buf_idx];
+
+        double t = frame * angle_per_frame;
+        szilv::Vertex new_center = {
+            width / 2.0 + orbit_x * cos(t * 0.3),
+            height / 2.0 + orbit_y * sin(t * 0.5),
+            0
+        };
+        new_triangle->translateToNewCenter(new_center);
+        new_triangle->rotateAroundTheCenter(angle_per_frame);
+
+        szilv::SquareDefinition squareCoordinates = defineTheSquareContainingTheTriangles(new_triangle, old_triangle);
+        squareCoordinates = {
+            std::max(0, squareCoordinates.x1), std::max(0, squareCoordinates.y1),
+            std::min((int32_t)width - 1, squareCoordinates.x2), std::min((int32_t)height - 1, squareCoordinates.y2)
+        };
+        distribute_triangle_draws(new_triangle, squareCoordinates, color_white, buf,
+                &old_rasterizers[buf_idx], &old_fixed_rasterizers[buf_idx]);
+
+        // wait for the whole frame once, the workers still read the old triangle of this buffer
+        pool->wait();
+        frame_tasks.clear();
+
+        // update the old Triangle
+        old_triangle->setPrimitive(new_triangle->getPrimitive());
+        old_rasterizers[buf_idx].setPrimitive(new_triangle->getPrimitive());
+        old_fixed_rasterizers[buf_idx].setPrimitive(new_triangle->getPrimitive());
+
+        if (double_buffering) {
+            // swap buffers
+            offscreen.swap_buffers();
+        }
+
+        if (frame >= nr_of_warm_up_frames) {
+            latencies.push_back(get_nanos() - frame_start);
+            drawn_pixels += (uint64_t)(squareCoordinates.x2 - squareCoordinates.x1 + 1)
+                * (squareCoordinates.y2 - squareCoordinates.y1 + 1);
+        }
+    }
+    int64_t measured = get_nanos() - measure_start;
+    delete pool;
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "path:         " << (simd_fill ? std::string("simd ") + szilv::TriangleFillSimd2D::getPathName()
+                : fixed_point ? "fixed point spans" : "spans") << std::endl;
+    std::cout << "buffer:       " << width << "x" << height << ", stride " << buf->stride
+        << (double_buffering ? ", double buffered" : "") << std::endl;
+    std::cout << "workers:      " << nr_of_draw_workers << ", slice " << buffer_slice << " rows" << std::endl;
+    std::cout << "frames:       " << nr_of_frames << " in " << (double)measured / NANO_TO_SEC_CONV << " s" << std::endl;
+    std::cout << "frames/s:     " << nr_of_frames * (double)NANO_TO_SEC_CONV / measured << std::endl;
+    std::cout << "ns/pixel:     " << (double)measured / drawn_pixels
+        << " (" << drawn_pixels / nr_of_frames << " pixels of the redrawn square per frame)" << std::endl;
+    std::cout << "latency us:   p50 " << percentile(latencies, 50) / 1000.0
+        << "  p95 " << percentile(latencies, 95) / 1000.0
+        << "  p99 " << percentile(latencies, 99) / 1000.0
+        << "  max " << latencies.back() / 1000.0 << std::endl;
+    std::cout << "checksum:     " << std::hex << szilv::OffscreenTarget::checksum(buf) << std::dec << std::endl;
+
+    return 0;
+}
@@ -1,9 +1,73 @@
 #include <iostream>
 
 #include "2D_line_drawer.hpp"
+#include "2D_triangle.hpp"
+#include "2D_rasterizer.hpp"
+#include "2D_triangle_simd.hpp"
+#include "trace.hpp"
 
 namespace szilv {
 
+    // The per-pixel shapes. setRow hoists everything that only depends on y, inside is called for every
+    // pixel of the row and inlines into fillRowsPerPixel.
+    class TriangleShape {
+        public:
+            TriangleShape(const TrianglePrimitive & t) : tr(t) {
+                // the y and x differences of the edges, the same operands BaseGeometry::sign computes
+                e1y = tr.p1.y - tr.p2.y; e1x = tr.p1.x - tr.p2.x;
+                e2y = tr.p2.y - tr.p3.y; e2x = tr.p2.x - tr.p3.x;
+                e3y = tr.p3.y - tr.p1.y; e3x = tr.p3.x - tr.p1.x;
+            }
+
+            void setRow(int32_t y) {
+                r1 = e1x * ((double)y - tr.p2.y);
+                r2 = e2x * ((double)y - tr.p3.y);
+                r3 = e3x * ((double)y - tr.p1.y);
+            }
+
+            // bit-exact with Triangle2D::pointInTriangle
+            bool inside(int32_t x) const {
+                double d1 = ((double)x - tr.p2.x) * e1y - r1;
+                double d2 = ((double)x - tr.p3.x) * e2y - r2;
+                double d3 = ((double)x - tr.p1.x) * e3y - r3;
+                bool has_neg = (d1 < 0) || (d2 < 0) || (d3 < 0);
+                bool has_pos = (d1 > 0) || (d2 > 0) || (d3 > 0);
+                return !(has_neg && has_pos);
+            }
+
+        private:
+            TrianglePrimitive tr;
+            double e1x, e1y, e2x, e2y, e3x, e3y;
+            double r1 = 0, r2 = 0, r3 = 0;
+    };
+
+    class MaskShape {
+        public:
+            MaskShape(const char * mask, const SquareDefinition & square)
+                : mask(mask), x1(square.x1), y1(square.y1), width(square.x2 - square.x1 + 1) {}
+
+            void setRow(int32_t y) { row = mask + (y - y1) * width - x1; }
+            bool inside(int32_t x) const { return row[x]; }
+
+        private:
+            const char * mask;
+            const char * row = nullptr;
+            int32_t x1, y1, width;
+    };
+
+    template <typename Shape>
+    static void fillRowsPerPixel(const DrawWork & w, Shape shape) {
+        for (int32_t y = w.squareDefinition.y1; y <= w.squareDefinition.y2; y++) {
+            // Find the start of the current row
+            uint32_t * row = reinterpret_cast<uint32_t *>(w.target_buff + (y * w.pitch));
+            shape.setRow(y);
+
+            for (int32_t x = w.squareDefinition.x1; x <= w.squareDefinition.x2; x++) {
+                row[x] = shape.inside(x) ? w.color : w.bg_color;
+            }
+        }
+    }
+
     LineDrawer2D::LineDrawer2D(uint32_t id, uint32_t x, uint32_t y) 
         : sem_work_queue(1), sem_block_this_thread(0), sem_block_main_thread(1) {
         this->id = id;
@@ -63,21 +127,53 @@ namespace szilv {
                 DrawWork w = work_queue.front();
                 work_queue.pop();
 
-                for (int32_t y = w.squareDefinition.y1; y <= w.squareDefinition.y2; y++) {
-                    // Find the start of the current row
-                    int32_t* row = reinterpret_cast<int32_t*>(w.target_buff + (y * w.pitch));
-
-                    for (int32_t x = w.squareDefinition.x1; x <= w.squareDefinition.x2; x++) {
-                        szilv::Vertex point = {(double)x, (double)y, 0.0};
-                        row[x] = w.isInside(point) 
-                            ? w.color 
-                            : w.bg_color;
-
-                    }
-                }
+                TraceScope trace("DrawWork", "LineDrawer2D", "y1", w.squareDefinition.y1);
+                drawWork(w);
             }
             sem_work_queue.notify();
             sem_block_main_thread.notify();
         }
     }
+
+    void DrawTask::run(uint32_t) {
+        TraceScope trace("DrawWork", "ThreadPool", "y1", work.squareDefinition.y1);
+        LineDrawer2D::drawWork(work);
+    }
+
+    /**
+     * Draws one slice with the most specific path the work item asks for
+     */
+    void LineDrawer2D::drawWork(const DrawWork & w) {
+        if (w.rasterizer && w.old_rasterizer) {
+            w.rasterizer->fillRowsDiff(w.target_buff, w.pitch, *w.old_rasterizer, w.squareDefinition,
+                    w.color, w.bg_color);
+            return;
+        }
+        if (w.rasterizer) {
+            w.rasterizer->fillRows(w.target_buff, w.pitch, w.squareDefinition, w.color, w.bg_color);
+            return;
+        }
+        if (w.fixed_rasterizer && w.old_fixed_rasterizer) {
+            w.fixed_rasterizer->fillRowsDiff(w.target_buff, w.pitch, *w.old_fixed_rasterizer, w.squareDefinition,
+                    w.color, w.bg_color);
+            return;
+        }
+        if (w.fixed_rasterizer) {
+            w.fixed_rasterizer->fillRows(w.target_buff, w.pitch, w.squareDefinition, w.color, w.bg_color);
+            return;
+        }
+        if (w.simd_fill) {
+            w.simd_fill->fillRows(w.target_buff, w.pitch, w.squareDefinition, w.color, w.bg_color);
+            return;
+        }
+
+        switch (w.shape) {
+            case SHAPE_TRIANGLE:
+                fillRowsPerPixel(w, TriangleShape(static_cast<Triangle2D *>(w.obj)->getPrimitive()));
+                break;
+            case SHAPE_MASK:
+                fillRowsPerPixel(w, MaskShape(static_cast<const char *>(w.obj), w.squareDefinition));
+                break;
+        }
+    }
 }
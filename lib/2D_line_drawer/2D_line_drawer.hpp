@@ -5,22 +5,41 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <functional>
 #include "base_geometry.hpp"
+#include "thread_pool.hpp"
 
 
 namespace szilv {
 
+    class Rasterizer2D;
+    class FixedRasterizer2D;
+    class TriangleFillSimd2D;
+
+    // what obj points to when none of the rasterizers is set, every shape has its own inlined per-pixel kernel
+    enum DrawShape {
+        SHAPE_TRIANGLE,     // obj is a Triangle2D, same coverage as pointInTriangle
+        SHAPE_MASK          // obj is a char mask of the square, one byte per pixel, row length x2 - x1 + 1
+    };
+
     struct DrawWorkStruct {
         uint32_t color;
         uint32_t bg_color;
         void * obj;
-        std::function<bool(szilv::Vertex)> isInside;
+        DrawShape shape;
         SquareDefinition squareDefinition;
         uint8_t * target_buff = nullptr;
         uint32_t pitch;
         uint32_t buff_width;
         uint32_t buff_height;
+        // when set, the rows are filled span by span instead of testing the shape pixel by pixel
+        const Rasterizer2D * rasterizer = nullptr;
+        // together with rasterizer: only the difference to the triangle drawn last time into this buffer is written
+        const Rasterizer2D * old_rasterizer = nullptr;
+        // when set, the coverage of the whole slice is evaluated by the SIMD kernel
+        const TriangleFillSimd2D * simd_fill = nullptr;
+        // the 28.4 fixed point counterparts of rasterizer and old_rasterizer
+        const FixedRasterizer2D * fixed_rasterizer = nullptr;
+        const FixedRasterizer2D * old_fixed_rasterizer = nullptr;
     };
     typedef DrawWorkStruct DrawWork;
 
@@ -58,6 +77,9 @@ namespace szilv {
             virtual void threadWorker();
             virtual void blockMainThreadUntilTheQueueIsNotEmpty();
 
+            // the body of the worker loop, shared with DrawTask
+            static void drawWork(const DrawWork & w);
+
         private:
             uint32_t id;
             bool keep_running = true;
@@ -68,6 +90,16 @@ namespace szilv {
             Semaphore sem_block_this_thread;
             Semaphore sem_block_main_thread;
     };
+
+    // a DrawWork as a ThreadPool task, the pool draws it on whichever worker gets to it first
+    class DrawTask : public PoolTask {
+        public:
+            DrawTask(DrawWork work) : work(work) {}
+            void run(uint32_t worker_id) override;
+
+        private:
+            DrawWork work;
+    };
 }
 
 #endif /* !defined(DRAW_WORKER_H) */
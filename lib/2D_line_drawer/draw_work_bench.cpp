@@ -0,0 +1,114 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "2D_line_drawer.hpp"
+#include "2D_triangle.hpp"
+#include "2D_rasterizer.hpp"
+
+/**
+ * Per-pixel cost of LineDrawer2D::drawWork on one big triangle, single threaded.
+ * "std::function" is the loop DrawWork used to run: a std::function per work item wrapping a lambda
+ * that calls the virtual pointInTriangle for every pixel. "shape kernel" is the inlined
+ * SHAPE_TRIANGLE path, "span rasterizer" the Rasterizer2D path for reference.
+ *
+ * usage: 2D_line_drawer_bench [iterations] [width] [height]
+ */
+
+const uint32_t color = 0xFFFFFF;
+const uint32_t bg_color = 0x0;
+
+static void drawWorkStdFunction(const szilv::DrawWork & w, std::function<bool(szilv::Vertex)> isInside) {
+    for (int32_t y = w.squareDefinition.y1; y <= w.squareDefinition.y2; y++) {
+        int32_t* row = reinterpret_cast<int32_t*>(w.target_buff + (y * w.pitch));
+
+        for (int32_t x = w.squareDefinition.x1; x <= w.squareDefinition.x2; x++) {
+            szilv::Vertex point = {(double)x, (double)y, 0.0};
+            row[x] = isInside(point)
+                ? w.color
+                : w.bg_color;
+        }
+    }
+}
+
+template <typename F>
+static double measure(uint32_t iterations, uint64_t pixels, F f) {
+    f(); // warm up
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        f();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / ((double)iterations * pixels);
+}
+
+int main(int argc, char **argv) {
+    uint32_t iterations = argc > 1 ? std::atoi(argv[1]) : 50;
+    uint32_t width = argc > 2 ? std::atoi(argv[2]) : 1920;
+    uint32_t height = argc > 3 ? std::atoi(argv[3]) : 1080;
+    uint32_t pitch = width * sizeof(uint32_t);
+    const uint32_t slice = 10;
+
+    std::vector<uint32_t> buff_before(width * height);
+    std::vector<uint32_t> buff_after(width * height);
+    szilv::Triangle2D triangle(
+            { width * 0.5, height * 0.05, 0 },
+            { width * 0.05, height * 0.95, 0 },
+            { width * 0.95, height * 0.9, 0 });
+    szilv::Triangle2D * tr = &triangle;
+    szilv::Rasterizer2D rasterizer(tr->getPrimitive());
+
+    // the same slicing the binaries use
+    std::vector<szilv::DrawWork> works;
+    for (int32_t y = 0; y < (int32_t)height; y += slice) {
+        szilv::SquareDefinition square_slice = {
+            0, y,
+            (int32_t)width - 1, std::min(y + (int32_t)slice - 1, (int32_t)height - 1)
+        };
+        szilv::DrawWork work = {
+            color, bg_color,
+            (void*)tr, szilv::SHAPE_TRIANGLE,
+            square_slice, nullptr,
+            pitch, width, height
+        };
+        works.push_back(work);
+    }
+    uint64_t pixels = (uint64_t)width * height;
+
+    double before = measure(iterations, pixels, [&]() {
+        for (auto w : works) {
+            w.target_buff = (uint8_t*)buff_before.data();
+            auto isInside = [tr](szilv::Vertex point) -> bool {
+                return tr->pointInTriangle(point);
+            };
+            drawWorkStdFunction(w, isInside);
+        }
+    });
+    double after = measure(iterations, pixels, [&]() {
+        for (auto w : works) {
+            w.target_buff = (uint8_t*)buff_after.data();
+            szilv::LineDrawer2D::drawWork(w);
+        }
+    });
+    bool same = std::memcmp(buff_before.data(), buff_after.data(), pixels * sizeof(uint32_t)) == 0;
+    double spans = measure(iterations, pixels, [&]() {
+        for (auto w : works) {
+            w.target_buff = (uint8_t*)buff_after.data();
+            w.rasterizer = &rasterizer;
+            szilv::LineDrawer2D::drawWork(w);
+        }
+    });
+
+    std::cout << width << "x" << height << ", " << iterations << " iterations, ns/pixel" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  std::function    " << before << std::endl;
+    std::cout << "  shape kernel     " << after << "  (" << before / after << "x)" << std::endl;
+    std::cout << "  span rasterizer  " << spans << "  (" << before / spans << "x)" << std::endl;
+    std::cout << "  output " << (same ? "identical" : "DIFFERS") << std::endl;
+
+    return same ? 0 : 1;
+}
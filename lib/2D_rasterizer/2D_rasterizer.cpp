@@ -0,0 +1,353 @@
+#include <cmath>
+#include <algorithm>
+#include "2D_rasterizer.hpp"
+
+namespace szilv {
+
+    /**
+     * The sign of an edge function is monotone along a scanline, so the pixels on one side of an edge form
+     * a half-line. Starting from the estimated crossing point, step to the first x in [lo, hi + 1] for which
+     * the (false..true ordered) predicate holds. The estimate is at most a pixel off, so this is a couple of
+     * evaluations per edge and row.
+     */
+    template<typename Pred>
+    static int32_t firstTrue(int32_t guess, int32_t lo, int32_t hi, Pred pred) {
+        int32_t x = guess;
+        while (x <= hi && !pred(x)) {
+            x++;
+        }
+        while (x > lo && pred(x - 1)) {
+            x--;
+        }
+        return x;
+    }
+
+    static int32_t rootToPixel(double root, int32_t lo, int32_t hi) {
+        if (!(root > lo)) {
+            return lo;
+        }
+        if (root > (double)hi + 1) {
+            return hi + 1;
+        }
+        return (int32_t)std::ceil(root);
+    }
+
+    static void fillSpan(uint32_t * row, int32_t x1, int32_t x2, uint32_t color) {
+        if (x1 <= x2) {
+            std::fill(row + x1, row + x2 + 1, color);
+        }
+    }
+
+    /**
+     * new span: color, old span minus the new one: bg_color. It is at most two pieces, one on each side
+     */
+    static void fillSpanDiff(uint32_t * row, Span n, Span o, uint32_t color, uint32_t bg_color) {
+        if (n.x1 > n.x2) {
+            fillSpan(row, o.x1, o.x2, bg_color);
+            return;
+        }
+        fillSpan(row, n.x1, n.x2, color);
+        fillSpan(row, o.x1, std::min(o.x2, n.x1 - 1), bg_color);
+        fillSpan(row, std::max(o.x1, n.x2 + 1), o.x2, bg_color);
+    }
+
+    static void fillSpanRow(uint32_t * row, Span s, int32_t x1, int32_t x2, uint32_t color, uint32_t bg_color) {
+        if (s.x1 > s.x2) {
+            fillSpan(row, x1, x2, bg_color);
+            return;
+        }
+        fillSpan(row, x1, s.x1 - 1, bg_color);
+        fillSpan(row, s.x1, s.x2, color);
+        fillSpan(row, s.x2 + 1, x2, bg_color);
+    }
+
+    Rasterizer2D::Rasterizer2D() {
+        setPrimitive({ {0, 0, 0}, {0, 0, 0}, {0, 0, 0} });
+    }
+
+    Rasterizer2D::Rasterizer2D(TrianglePrimitive trg_prm) {
+        setPrimitive(trg_prm);
+    }
+
+    void Rasterizer2D::setPrimitive(TrianglePrimitive trg_prm) {
+        // the same vertex pairs Triangle2D::pointInTriangle passes to BaseGeometry::sign
+        Vertex us[3] = { trg_prm.p1, trg_prm.p2, trg_prm.p3 };
+        Vertex vs[3] = { trg_prm.p2, trg_prm.p3, trg_prm.p1 };
+        for (int32_t i = 0; i < 3; i++) {
+            EdgeEquation & e = edges[i];
+            e.u = us[i];
+            e.v = vs[i];
+            e.a = e.u.y - e.v.y;
+            if (e.a != 0) {
+                e.slope = (e.u.x - e.v.x) / e.a;
+                e.root = e.v.x - e.slope * e.v.y;
+            } else {
+                e.slope = 0;
+                e.root = 0;
+            }
+        }
+    }
+
+    /**
+     * Computes the pixels of row y where all the three edge functions are >= 0 (pos) and where all of them
+     * are <= 0 (neg). Their union is exactly what Triangle2D::pointInTriangle accepts.
+     */
+    void Rasterizer2D::rowSpans(int32_t y, const double roots[3], int32_t x1, int32_t x2, Span * pos, Span * neg) const {
+        *pos = { x1, x2 };
+        *neg = { x1, x2 };
+        for (int32_t i = 0; i < 3; i++) {
+            const EdgeEquation & e = edges[i];
+            auto d = [&e, y](int32_t x) -> double {
+                return BaseGeometry::sign({(double)x, (double)y, 0.0}, e.u, e.v);
+            };
+
+            if (e.a == 0) {
+                // horizontal edge, the sign is the same for the whole row
+                double val = d(x1);
+                if (!(val >= 0)) {
+                    pos->x2 = pos->x1 - 1;
+                }
+                if (!(val <= 0)) {
+                    neg->x2 = neg->x1 - 1;
+                }
+                continue;
+            }
+
+            int32_t guess = rootToPixel(roots[i], x1, x2);
+            if (e.a > 0) {
+                pos->x1 = std::max(pos->x1, firstTrue(guess, x1, x2, [&d](int32_t x) { return d(x) >= 0; }));
+                neg->x2 = std::min(neg->x2, firstTrue(guess, x1, x2, [&d](int32_t x) { return d(x) > 0; }) - 1);
+            } else {
+                pos->x2 = std::min(pos->x2, firstTrue(guess, x1, x2, [&d](int32_t x) { return d(x) < 0; }) - 1);
+                neg->x1 = std::max(neg->x1, firstTrue(guess, x1, x2, [&d](int32_t x) { return d(x) <= 0; }));
+            }
+        }
+    }
+
+    void Rasterizer2D::initRoots(int32_t y, double roots[3]) const {
+        for (int32_t i = 0; i < 3; i++) {
+            roots[i] = edges[i].root + edges[i].slope * y;
+        }
+    }
+
+    void Rasterizer2D::stepRoots(double roots[3]) const {
+        for (int32_t i = 0; i < 3; i++) {
+            roots[i] += edges[i].slope;
+        }
+    }
+
+    Span Rasterizer2D::spanFromRoots(int32_t y, const double roots[3], int32_t x1, int32_t x2) const {
+        Span pos, neg;
+        rowSpans(y, roots, x1, x2, &pos, &neg);
+        if (pos.x1 > pos.x2) {
+            return neg;
+        }
+        if (neg.x1 > neg.x2) {
+            return pos;
+        }
+        // both are only non-empty for degenerate triangles, return the hull
+        return { std::min(pos.x1, neg.x1), std::max(pos.x2, neg.x2) };
+    }
+
+    Span Rasterizer2D::getSpan(int32_t y, int32_t x1, int32_t x2) const {
+        double roots[3];
+        initRoots(y, roots);
+        return spanFromRoots(y, roots, x1, x2);
+    }
+
+    void Rasterizer2D::fillRowFromRoots(uint32_t * row, int32_t y, const double roots[3], int32_t x1, int32_t x2,
+            uint32_t color, uint32_t bg_color) const {
+        Span pos, neg;
+        rowSpans(y, roots, x1, x2, &pos, &neg);
+
+        Span s;
+        if (pos.x1 > pos.x2) {
+            s = neg;
+        } else if (neg.x1 > neg.x2) {
+            s = pos;
+        } else if (std::max(pos.x1, neg.x1) <= std::min(pos.x2, neg.x2) + 1) {
+            s = { std::min(pos.x1, neg.x1), std::max(pos.x2, neg.x2) };
+        } else {
+            // degenerate triangle with two separate runs on this row
+            for (int32_t x = x1; x <= x2; x++) {
+                bool inside = (x >= pos.x1 && x <= pos.x2) || (x >= neg.x1 && x <= neg.x2);
+                row[x] = inside ? color : bg_color;
+            }
+            return;
+        }
+
+        fillSpanRow(row, s, x1, x2, color, bg_color);
+    }
+
+    void Rasterizer2D::fillRow(uint32_t * row, int32_t y, int32_t x1, int32_t x2, uint32_t color, uint32_t bg_color) const {
+        double roots[3];
+        initRoots(y, roots);
+        fillRowFromRoots(row, y, roots, x1, x2, color, bg_color);
+    }
+
+    void Rasterizer2D::fillRows(uint8_t * target_buff, uint32_t pitch, SquareDefinition square,
+            uint32_t color, uint32_t bg_color) const {
+        // the crossing points are stepped incrementally from row to row
+        double roots[3];
+        initRoots(square.y1, roots);
+        for (int32_t y = square.y1; y <= square.y2; y++) {
+            uint32_t * row = reinterpret_cast<uint32_t*>(target_buff + (y * pitch));
+            fillRowFromRoots(row, y, roots, square.x1, square.x2, color, bg_color);
+            stepRoots(roots);
+        }
+    }
+
+    void Rasterizer2D::fillRowDiff(uint32_t * row, int32_t y, const Rasterizer2D & old, int32_t x1, int32_t x2,
+            uint32_t color, uint32_t bg_color) const {
+        fillSpanDiff(row, getSpan(y, x1, x2), old.getSpan(y, x1, x2), color, bg_color);
+    }
+
+    void Rasterizer2D::fillRowsDiff(uint8_t * target_buff, uint32_t pitch, const Rasterizer2D & old, SquareDefinition square,
+            uint32_t color, uint32_t bg_color) const {
+        double roots[3];
+        double old_roots[3];
+        initRoots(square.y1, roots);
+        old.initRoots(square.y1, old_roots);
+        for (int32_t y = square.y1; y <= square.y2; y++) {
+            uint32_t * row = reinterpret_cast<uint32_t*>(target_buff + (y * pitch));
+            fillSpanDiff(row,
+                    spanFromRoots(y, roots, square.x1, square.x2),
+                    old.spanFromRoots(y, old_roots, square.x1, square.x2),
+                    color, bg_color);
+            stepRoots(roots);
+            old.stepRoots(old_roots);
+        }
+    }
+
+    static int64_t floorDiv(int64_t a, int64_t b) {
+        int64_t q = a / b;
+        return (a % b != 0 && a < 0) ? q - 1 : q;
+    }
+
+    static int64_t ceilDiv(int64_t a, int64_t b) {
+        int64_t q = a / b;
+        return (a % b != 0 && a > 0) ? q + 1 : q;
+    }
+
+    FixedRasterizer2D::FixedRasterizer2D() {
+        setPrimitive({ {0, 0, 0}, {0, 0, 0}, {0, 0, 0} });
+    }
+
+    FixedRasterizer2D::FixedRasterizer2D(TrianglePrimitive trg_prm) {
+        setPrimitive(trg_prm);
+    }
+
+    /**
+     * Snaps the vertices to 1/16 pixel and sets up the edges so the interior is on the positive side.
+     * Pixel (x, y) is sampled at the subpixel position (x << 4, y << 4), like the double path samples
+     * at the integer coordinates.
+     */
+    void FixedRasterizer2D::setPrimitive(TrianglePrimitive trg_prm) {
+        FixedVertex v[3] = {
+            BaseGeometry::snapToSubpixel(trg_prm.p1),
+            BaseGeometry::snapToSubpixel(trg_prm.p2),
+            BaseGeometry::snapToSubpixel(trg_prm.p3)
+        };
+
+        int64_t area = (int64_t)(v[1].x - v[0].x) * (v[2].y - v[0].y) - (int64_t)(v[1].y - v[0].y) * (v[2].x - v[0].x);
+        empty = area == 0;
+        if (area < 0) {
+            std::swap(v[1], v[2]);
+        }
+
+        for (int32_t i = 0; i < 3; i++) {
+            const FixedVertex & a = v[i];
+            const FixedVertex & b = v[(i + 1) % 3];
+            int64_t dx = b.x - a.x;
+            int64_t dy = b.y - a.y;
+            // y grows downwards: on a left edge the interior is to the right, on a top edge it is below
+            bool top_left = dy < 0 || (dy == 0 && dx > 0);
+            // E(X, Y) = dx * (Y - a.y) - dy * (X - a.x) with X = x << 4, Y = y << 4
+            edges[i].c = dy * a.x - dx * a.y - (top_left ? 0 : 1);
+            edges[i].step_x = -dy * SUBPIXEL_ONE;
+            edges[i].step_y = dx * SUBPIXEL_ONE;
+        }
+    }
+
+    void FixedRasterizer2D::initRows(int32_t y, int64_t rows[3]) const {
+        for (int32_t i = 0; i < 3; i++) {
+            rows[i] = edges[i].c + edges[i].step_y * y;
+        }
+    }
+
+    void FixedRasterizer2D::stepRows(int64_t rows[3]) const {
+        for (int32_t i = 0; i < 3; i++) {
+            rows[i] += edges[i].step_y;
+        }
+    }
+
+    /**
+     * rows[i] is the edge function at x = 0 of the row, so each edge bounds the span from one side
+     * with a single integer division
+     */
+    Span FixedRasterizer2D::spanFromRows(const int64_t rows[3], int32_t x1, int32_t x2) const {
+        int64_t lo = x1;
+        int64_t hi = x2;
+        if (empty) {
+            return { x1, x1 - 1 };
+        }
+        for (int32_t i = 0; i < 3; i++) {
+            int64_t step = edges[i].step_x;
+            if (step > 0) {
+                lo = std::max(lo, ceilDiv(-rows[i], step));
+            } else if (step < 0) {
+                hi = std::min(hi, floorDiv(rows[i], -step));
+            } else if (rows[i] < 0) {
+                return { x1, x1 - 1 };
+            }
+        }
+        if (lo > hi) {
+            return { x1, x1 - 1 };
+        }
+        return { (int32_t)lo, (int32_t)hi };
+    }
+
+    Span FixedRasterizer2D::getSpan(int32_t y, int32_t x1, int32_t x2) const {
+        int64_t rows[3];
+        initRows(y, rows);
+        return spanFromRows(rows, x1, x2);
+    }
+
+    void FixedRasterizer2D::fillRow(uint32_t * row, int32_t y, int32_t x1, int32_t x2,
+            uint32_t color, uint32_t bg_color) const {
+        fillSpanRow(row, getSpan(y, x1, x2), x1, x2, color, bg_color);
+    }
+
+    void FixedRasterizer2D::fillRows(uint8_t * target_buff, uint32_t pitch, SquareDefinition square,
+            uint32_t color, uint32_t bg_color) const {
+        int64_t rows[3];
+        initRows(square.y1, rows);
+        for (int32_t y = square.y1; y <= square.y2; y++) {
+            uint32_t * row = reinterpret_cast<uint32_t*>(target_buff + (y * pitch));
+            fillSpanRow(row, spanFromRows(rows, square.x1, square.x2), square.x1, square.x2, color, bg_color);
+            stepRows(rows);
+        }
+    }
+
+    void FixedRasterizer2D::fillRowDiff(uint32_t * row, int32_t y, const FixedRasterizer2D & old, int32_t x1, int32_t x2,
+            uint32_t color, uint32_t bg_color) const {
+        fillSpanDiff(row, getSpan(y, x1, x2), old.getSpan(y, x1, x2), color, bg_color);
+    }
+
+    void FixedRasterizer2D::fillRowsDiff(uint8_t * target_buff, uint32_t pitch, const FixedRasterizer2D & old, SquareDefinition square,
+            uint32_t color, uint32_t bg_color) const {
+        int64_t rows[3];
+        int64_t old_rows[3];
+        initRows(square.y1, rows);
+        old.initRows(square.y1, old_rows);
+        for (int32_t y = square.y1; y <= square.y2; y++) {
+            uint32_t * row = reinterpret_cast<uint32_t*>(target_buff + (y * pitch));
+            fillSpanDiff(row,
+                    spanFromRows(rows, square.x1, square.x2),
+                    old.spanFromRows(old_rows, square.x1, square.x2),
+                    color, bg_color);
+            stepRows(rows);
+            old.stepRows(old_rows);
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#if !defined(RASTERIZER_2D_H)
+#define RASTERIZER_2D_H
+
+#include <cstdint>
+#include "base_geometry.hpp"
+#include "2D_triangle.hpp"
+
+namespace szilv {
+
+    // one edge of the triangle, (u, v) in the same order as Triangle2D::pointInTriangle uses them.
+    // The edge crosses a scanline y at root + slope * y, "a" tells in which direction the sign grows along x
+    typedef struct {
+        Vertex u;
+        Vertex v;
+        double a;
+        double root;
+        double slope;
+    } EdgeEquation;
+
+    // inclusive [x1, x2] interval of one scanline, empty when x1 > x2
+    typedef struct {
+        int32_t x1;
+        int32_t x2;
+    } Span;
+
+    // integer edge function of the fixed point path, E(x, y) = c + step_x * x + step_y * y at pixel (x, y).
+    // The top-left fill rule is folded into c, so a pixel is covered when E >= 0 for all three edges
+    typedef struct {
+        int64_t c;
+        int64_t step_x;
+        int64_t step_y;
+    } FixedEdge;
+
+    class Rasterizer2D {
+        public:
+            Rasterizer2D();
+            Rasterizer2D(TrianglePrimitive trg_prm);
+
+            virtual void setPrimitive(TrianglePrimitive trg_prm);
+
+            // the covered pixels of row y clipped to [x1, x2]
+            Span getSpan(int32_t y, int32_t x1, int32_t x2) const;
+            // writes color to the covered pixels and bg_color to the rest of [x1, x2]
+            void fillRow(uint32_t * row, int32_t y, int32_t x1, int32_t x2, uint32_t color, uint32_t bg_color) const;
+            void fillRows(uint8_t * target_buff, uint32_t pitch, SquareDefinition square,
+                    uint32_t color, uint32_t bg_color) const;
+
+            // assumes the row still shows the old triangle: writes the covered span once and clears only
+            // the pixels old covered but this one does not. Nothing else inside [x1, x2] is touched
+            void fillRowDiff(uint32_t * row, int32_t y, const Rasterizer2D & old, int32_t x1, int32_t x2,
+                    uint32_t color, uint32_t bg_color) const;
+            void fillRowsDiff(uint8_t * target_buff, uint32_t pitch, const Rasterizer2D & old, SquareDefinition square,
+                    uint32_t color, uint32_t bg_color) const;
+
+        private:
+            EdgeEquation edges[3];
+
+            void initRoots(int32_t y, double roots[3]) const;
+            void stepRoots(double roots[3]) const;
+            Span spanFromRoots(int32_t y, const double roots[3], int32_t x1, int32_t x2) const;
+            void rowSpans(int32_t y, const double roots[3], int32_t x1, int32_t x2, Span * pos, Span * neg) const;
+            void fillRowFromRoots(uint32_t * row, int32_t y, const double roots[3], int32_t x1, int32_t x2,
+                    uint32_t color, uint32_t bg_color) const;
+    };
+
+    // the same fill interface on vertices snapped to 28.4 fixed point. Everything after the setup is integer
+    // math and shared edges are watertight: a pixel on an edge between two triangles is drawn by exactly one
+    class FixedRasterizer2D {
+        public:
+            FixedRasterizer2D();
+            FixedRasterizer2D(TrianglePrimitive trg_prm);
+
+            virtual void setPrimitive(TrianglePrimitive trg_prm);
+            const FixedEdge * getEdges() const { return edges; }
+            bool isEmpty() const { return empty; }
+
+            Span getSpan(int32_t y, int32_t x1, int32_t x2) const;
+            void fillRow(uint32_t * row, int32_t y, int32_t x1, int32_t x2, uint32_t color, uint32_t bg_color) const;
+            void fillRows(uint8_t * target_buff, uint32_t pitch, SquareDefinition square,
+                    uint32_t color, uint32_t bg_color) const;
+            void fillRowDiff(uint32_t * row, int32_t y, const FixedRasterizer2D & old, int32_t x1, int32_t x2,
+                    uint32_t color, uint32_t bg_color) const;
+            void fillRowsDiff(uint8_t * target_buff, uint32_t pitch, const FixedRasterizer2D & old, SquareDefinition square,
+                    uint32_t color, uint32_t bg_color) const;
+
+        private:
+            FixedEdge edges[3];
+            bool empty;
+
+            void initRows(int32_t y, int64_t rows[3]) const;
+            void stepRows(int64_t rows[3]) const;
+            Span spanFromRows(const int64_t rows[3], int32_t x1, int32_t x2) const;
+    };
+}
+
+#endif /* !defined(RASTERIZER_2D_H) */
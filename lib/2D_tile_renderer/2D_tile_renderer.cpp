@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "2D_tile_renderer.hpp"
+
+namespace szilv {
+
+    void TileTask2D::run(uint32_t worker_id) {
+        renderer->renderTile(tile, renderer->locals[worker_id].data());
+    }
+
+    TileRenderer2D::TileRenderer2D(ThreadPool * pool, uint32_t tile_size) : pool(pool) {
+        this->tile_size = std::max(8U, tile_size);
+        uint32_t nr_of_locals = pool ? pool->getNrOfWorkers() + 1 : 1;
+        locals.assign(nr_of_locals, std::vector<uint32_t>(this->tile_size * this->tile_size));
+    }
+
+    /**
+     * Sets up the fixed point edge functions once per triangle and appends the triangle to the list of
+     * every tile its bounding box touches
+     */
+    void TileRenderer2D::bin(const TrianglePrimitive * triangles, const uint32_t * colors, uint32_t count) {
+        tiles_x = (buff_width + tile_size - 1) / tile_size;
+        tiles_y = (buff_height + tile_size - 1) / tile_size;
+        bins.resize(tiles_x * tiles_y);
+        for (auto & b : bins) {
+            b.clear();
+        }
+        rasterizers.resize(count);
+        tri_bounds.resize(count);
+        tri_colors.assign(colors, colors + count);
+
+        stats = { tiles_x * tiles_y, 0, 0 };
+        for (uint32_t i = 0; i < count; i++) {
+            const TrianglePrimitive & t = triangles[i];
+            rasterizers[i].setPrimitive(t);
+            if (rasterizers[i].isEmpty()) {
+                continue;
+            }
+
+            double min_x = std::floor(std::min({t.p1.x, t.p2.x, t.p3.x}));
+            double min_y = std::floor(std::min({t.p1.y, t.p2.y, t.p3.y}));
+            double max_x = std::ceil(std::max({t.p1.x, t.p2.x, t.p3.x}));
+            double max_y = std::ceil(std::max({t.p1.y, t.p2.y, t.p3.y}));
+            if (max_x < 0 || max_y < 0 || min_x >= buff_width || min_y >= buff_height) {
+                continue;
+            }
+            SquareDefinition bounds = {
+                (int32_t)std::max(0.0, min_x),
+                (int32_t)std::max(0.0, min_y),
+                (int32_t)std::min((double)buff_width - 1, max_x),
+                (int32_t)std::min((double)buff_height - 1, max_y)
+            };
+            tri_bounds[i] = bounds;
+
+            for (uint32_t ty = bounds.y1 / tile_size; ty <= bounds.y2 / tile_size; ty++) {
+                for (uint32_t tx = bounds.x1 / tile_size; tx <= bounds.x2 / tile_size; tx++) {
+                    bins[ty * tiles_x + tx].push_back(i);
+                    stats.binned_triangles++;
+                }
+            }
+        }
+        for (auto & b : bins) {
+            if (b.empty()) {
+                stats.empty_tiles++;
+            }
+        }
+    }
+
+    void TileRenderer2D::render(const TrianglePrimitive * triangles, const uint32_t * colors, uint32_t count,
+            uint8_t * target_buff, uint32_t pitch, uint32_t buff_width, uint32_t buff_height,
+            uint32_t bg_color) {
+        this->target_buff = target_buff;
+        this->pitch = pitch;
+        this->buff_width = buff_width;
+        this->buff_height = buff_height;
+        this->bg_color = bg_color;
+        bin(triangles, colors, count);
+
+        uint32_t nr_of_tiles = tiles_x * tiles_y;
+        if (!pool) {
+            for (uint32_t tile = 0; tile < nr_of_tiles; tile++) {
+                renderTile(tile, locals[0].data());
+            }
+            return;
+        }
+
+        // whole tiles are stolen by the idle workers, so an expensive tile does not hold back the rest
+        if (tile_tasks.size() != nr_of_tiles) {
+            tile_tasks.clear();
+            for (uint32_t tile = 0; tile < nr_of_tiles; tile++) {
+                tile_tasks.push_back(TileTask2D(this, tile));
+            }
+        }
+        for (auto & task : tile_tasks) {
+            pool->submit(&task);
+        }
+        // the waiting thread renders tiles too, with the last local buffer
+        pool->wait();
+    }
+
+    /**
+     * Composes one tile in the local buffer, then copies it row by row to the target
+     */
+    void TileRenderer2D::renderTile(uint32_t tile, uint32_t * local) {
+        int32_t x1 = (tile % tiles_x) * tile_size;
+        int32_t y1 = (tile / tiles_x) * tile_size;
+        int32_t x2 = std::min(x1 + tile_size, buff_width) - 1;
+        int32_t y2 = std::min(y1 + tile_size, buff_height) - 1;
+        int32_t width = x2 - x1 + 1;
+
+        for (int32_t y = y1; y <= y2; y++) {
+            std::fill(local + (y - y1) * tile_size, local + (y - y1) * tile_size + width, bg_color);
+        }
+
+        for (uint32_t i : bins[tile]) {
+            const FixedRasterizer2D & r = rasterizers[i];
+            const SquareDefinition & b = tri_bounds[i];
+            uint32_t color = tri_colors[i];
+            for (int32_t y = std::max(y1, b.y1); y <= std::min(y2, b.y2); y++) {
+                Span s = r.getSpan(y, std::max(x1, b.x1), std::min(x2, b.x2));
+                if (s.x1 <= s.x2) {
+                    uint32_t * row = local + (y - y1) * tile_size - x1;
+                    std::fill(row + s.x1, row + s.x2 + 1, color);
+                }
+            }
+        }
+
+        for (int32_t y = y1; y <= y2; y++) {
+            std::memcpy(target_buff + y * pitch + x1 * sizeof(uint32_t), local + (y - y1) * tile_size,
+                    width * sizeof(uint32_t));
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#if !defined(TILE_RENDERER_2D_H)
+#define TILE_RENDERER_2D_H
+
+#include <cstdint>
+#include <vector>
+#include "base_geometry.hpp"
+#include "2D_triangle.hpp"
+#include "2D_rasterizer.hpp"
+#include "thread_pool.hpp"
+
+namespace szilv {
+
+    typedef struct {
+        uint32_t tiles;
+        uint32_t binned_triangles;  // sum of the triangle lists of all the tiles
+        uint32_t empty_tiles;
+    } TileStats;
+
+    class TileRenderer2D;
+
+    // one screen tile of the frame
+    class TileTask2D : public PoolTask {
+        public:
+            TileTask2D(TileRenderer2D * renderer, uint32_t tile) : renderer(renderer), tile(tile) {}
+            void run(uint32_t worker_id) override;
+
+        private:
+            TileRenderer2D * renderer;
+            uint32_t tile;
+    };
+
+    // Draws a whole list of triangles per frame. The triangles are binned into tile_size x tile_size
+    // screen tiles and every tile is one pool task, so a tile is composed in a worker local buffer
+    // that stays in L1/L2 and is written out once. With 64 pixel tiles and a 64 byte aligned target
+    // no two workers share a cache line. Without a pool the tiles are drawn on the calling thread.
+    class TileRenderer2D {
+        public:
+            TileRenderer2D(ThreadPool * pool, uint32_t tile_size = 64);
+
+            // painter's order: a later triangle covers an earlier one. Blocks until the frame is written
+            virtual void render(const TrianglePrimitive * triangles, const uint32_t * colors, uint32_t count,
+                    uint8_t * target_buff, uint32_t pitch, uint32_t buff_width, uint32_t buff_height,
+                    uint32_t bg_color);
+            TileStats getStats() { return stats; }
+
+        private:
+            uint32_t tile_size;
+            uint32_t tiles_x = 0;
+            uint32_t tiles_y = 0;
+            TileStats stats = {0, 0, 0};
+
+            // the frame being rendered, read only for the workers
+            std::vector<FixedRasterizer2D> rasterizers;
+            std::vector<SquareDefinition> tri_bounds;
+            std::vector<uint32_t> tri_colors;
+            std::vector<std::vector<uint32_t>> bins;
+            uint8_t * target_buff = nullptr;
+            uint32_t pitch = 0;
+            uint32_t buff_width = 0;
+            uint32_t buff_height = 0;
+            uint32_t bg_color = 0;
+
+            ThreadPool * pool;
+            // one tile buffer per pool worker plus one for the waiting thread, indexed by worker_id
+            std::vector<std::vector<uint32_t>> locals;
+            std::vector<TileTask2D> tile_tasks;
+
+            void bin(const TrianglePrimitive * triangles, const uint32_t * colors, uint32_t count);
+            void renderTile(uint32_t tile, uint32_t * local);
+
+            friend class TileTask2D;
+    };
+}
+
+#endif /* !defined(TILE_RENDERER_2D_H) */
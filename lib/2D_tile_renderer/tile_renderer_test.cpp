@@ -0,0 +1,97 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <algorithm>
+#include <vector>
+#include <string>
+
+#include "base_geometry.hpp"
+#include "2D_triangle.hpp"
+#include "2D_rasterizer.hpp"
+#include "thread_pool.hpp"
+#include "2D_tile_renderer.hpp"
+
+/**
+ * Renders frames of random triangles with TileRenderer2D, without a pool and on ThreadPools of several
+ * sizes, and compares every pixel with a single threaded painter's order fill of the same
+ * FixedRasterizer2D spans. The buffer is not a multiple of the tile size, so the partial tiles at the
+ * right and bottom edges are covered too. Exits with 1 on the first mismatching pixel.
+ *
+ * usage: 2D_tile_renderer_test [triangles] [seed]
+ */
+
+static const uint32_t width = 301;
+static const uint32_t height = 173;
+static const uint32_t bg_color = 0x00102030;
+
+static void reference(const std::vector<szilv::TrianglePrimitive> & triangles, const std::vector<uint32_t> & colors,
+        std::vector<uint32_t> & buff) {
+    std::fill(buff.begin(), buff.end(), bg_color);
+    for (size_t i = 0; i < triangles.size(); i++) {
+        szilv::FixedRasterizer2D r(triangles[i]);
+        if (r.isEmpty()) {
+            continue;
+        }
+        for (int32_t y = 0; y < (int32_t)height; y++) {
+            szilv::Span s = r.getSpan(y, 0, width - 1);
+            for (int32_t x = s.x1; x <= s.x2; x++) {
+                buff[y * width + x] = colors[i];
+            }
+        }
+    }
+}
+
+static bool check(const char * name, szilv::ThreadPool * pool, uint32_t tile_size,
+        const std::vector<szilv::TrianglePrimitive> & triangles, const std::vector<uint32_t> & colors,
+        const std::vector<uint32_t> & expected) {
+    szilv::TileRenderer2D renderer(pool, tile_size);
+    std::vector<uint32_t> buff(width * height);
+    // twice, the second frame reuses the bins and the tasks of the first
+    for (uint32_t frame = 0; frame < 2; frame++) {
+        std::fill(buff.begin(), buff.end(), 0xdeadbeef);
+        renderer.render(triangles.data(), colors.data(), triangles.size(), (uint8_t*)buff.data(),
+                width * sizeof(uint32_t), width, height, bg_color);
+        for (uint32_t i = 0; i < width * height; i++) {
+            if (buff[i] != expected[i]) {
+                std::cerr << name << ", tile " << tile_size << ": pixel (" << i % width << ", " << i / width
+                    << ") is " << std::hex << buff[i] << ", expected " << expected[i] << std::dec << std::endl;
+                return false;
+            }
+        }
+    }
+    std::cout << name << ", tile " << tile_size << ": " << triangles.size() << " triangles match" << std::endl;
+    return true;
+}
+
+int main(int argc, char ** argv) {
+    uint32_t nr_of_triangles = argc > 1 ? atoi(argv[1]) : 500;
+    uint32_t seed = argc > 2 ? atoi(argv[2]) : 1;
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> px(-20.0, width + 20.0);
+    std::uniform_real_distribution<double> py(-20.0, height + 20.0);
+    std::uniform_real_distribution<double> size(1.0, 40.0);
+    std::vector<szilv::TrianglePrimitive> triangles;
+    std::vector<uint32_t> colors;
+    for (uint32_t i = 0; i < nr_of_triangles; i++) {
+        // mostly small ones like the shapes of a dashboard, every tenth spans many tiles
+        double s = i % 10 ? size(rng) : size(rng) * 8;
+        szilv::Vertex c = { px(rng), py(rng), 0 };
+        triangles.push_back({ { c.x, c.y - s, 0 }, { c.x - s, c.y + s * 0.7, 0 }, { c.x + s * 0.9, c.y + s, 0 } });
+        colors.push_back(rng() & 0x00ffffff);
+    }
+    std::vector<uint32_t> expected(width * height);
+    reference(triangles, colors, expected);
+
+    bool ok = true;
+    for (uint32_t tile_size : { 8U, 64U }) {
+        ok = check("no pool", nullptr, tile_size, triangles, colors, expected) && ok;
+        for (uint32_t nr_of_workers : { 0U, 1U, 3U }) {
+            szilv::ThreadPool pool(nr_of_workers);
+            std::string name = std::to_string(nr_of_workers) + " workers";
+            ok = check(name.c_str(), &pool, tile_size, triangles, colors, expected) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -6,31 +6,46 @@
 
 namespace szilv {
 
-    typedef struct {
-        Vertex p1;
-        Vertex p2;
-        Vertex p3;
-    } TrianglePrimitive;
+    template <typename T>
+    struct BasicTrianglePrimitive {
+        BasicVertex<T> p1;
+        BasicVertex<T> p2;
+        BasicVertex<T> p3;
+    };
+
+    typedef BasicTrianglePrimitive<double> TrianglePrimitive;
+    typedef BasicTrianglePrimitive<float> TrianglePrimitiveF;
+    typedef BasicTrianglePrimitive<Fixed> TrianglePrimitiveFixed;
 
-    class Triangle2D {
+    // instantiated for float, double and Fixed in 2D_triangle.cpp, the renderers use the double one
+    template <typename T>
+    class BasicTriangle2D {
         public:
-            Triangle2D(Vertex v1, Vertex v2, Vertex v3);
-            Triangle2D(TrianglePrimitive trg_prm);
-            Triangle2D(Triangle2D *trg);
+            BasicTriangle2D(BasicVertex<T> v1, BasicVertex<T> v2, BasicVertex<T> v3);
+            BasicTriangle2D(BasicTrianglePrimitive<T> trg_prm);
+            BasicTriangle2D(BasicTriangle2D *trg);
 
-            virtual Vertex getCenter();
+            virtual BasicVertex<T> getCenter();
             virtual uint32_t getRadiusOfTheOuterCircle();
-            virtual bool pointInTriangle(Vertex point);
-            TrianglePrimitive getPrimitive() { return tr; }
-            virtual void setPrimitive(TrianglePrimitive trg_prm);
-            virtual void translateToNewCenter(Vertex new_centroid);
+            virtual bool pointInTriangle(BasicVertex<T> point);
+            BasicTrianglePrimitive<T> getPrimitive() { return tr; }
+            virtual void setPrimitive(BasicTrianglePrimitive<T> trg_prm);
+            virtual void translateToNewCenter(BasicVertex<T> new_centroid);
             virtual void rotateAroundTheCenter(double angle);
 
-            static double distance(Vertex p1, Vertex p2);
+            static T distance(BasicVertex<T> p1, BasicVertex<T> p2);
         private:
-            TrianglePrimitive tr;
+            BasicTrianglePrimitive<T> tr;
 
     };
+
+    extern template class BasicTriangle2D<float>;
+    extern template class BasicTriangle2D<double>;
+    extern template class BasicTriangle2D<Fixed>;
+
+    typedef BasicTriangle2D<double> Triangle2D;
+    typedef BasicTriangle2D<float> Triangle2DF;
+    typedef BasicTriangle2D<Fixed> Triangle2DFixed;
 }
 
 #endif /* !defined(TRIANGLE) */
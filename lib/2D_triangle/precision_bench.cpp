@@ -0,0 +1,110 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "base_geometry.hpp"
+#include "vertex_buffer.hpp"
+#include "2D_triangle.hpp"
+
+/**
+ * Throughput of the float, double and Fixed instantiations of the geometry templates: a batch rotation
+ * of a VertexBuffer2D (twice the vertices per AVX register for float, half the memory traffic) and the
+ * pointInTriangle test of every pixel of a frame. The inside tests are compared against double, the
+ * differences are pixels right on an edge.
+ *
+ * usage: precision_bench [vertices] [iterations] [width] [height]
+ */
+
+volatile uint64_t sink;
+
+template <typename F>
+static double measure(uint32_t iterations, F f) {
+    f(); // warm up
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        f();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+/**
+ * ns per vertex
+ */
+template <typename T>
+static double transformRun(uint32_t nr_of_vertices, uint32_t iterations) {
+    szilv::BasicVertexBuffer2D<T> buffer(nr_of_vertices);
+    for (uint32_t i = 0; i < nr_of_vertices; i++) {
+        buffer.set(i, { T((int)(i % 1920)), T((int)(i / 1920 % 1080)), T(0) });
+    }
+    szilv::Affine2D m = szilv::BaseGeometry::rotation2D({ 960, 540, 0 }, 0.001);
+    return measure(iterations, [&]() { buffer.transform(m); }) / nr_of_vertices;
+}
+
+/**
+ * ns per pixel, the covered pixels in covered and the ones different from reference in diff
+ */
+template <typename T>
+static double insideRun(uint32_t width, uint32_t height, uint32_t iterations,
+        const std::vector<bool> * reference, std::vector<bool> & inside, uint64_t & diff) {
+    szilv::BasicTriangle2D<T> triangle(
+            { T(width * 0.5), T(height * 0.1), T(0) },
+            { T(width * 0.1), T(height * 0.9), T(0) },
+            { T(width * 0.9), T(height * 0.7), T(0) });
+    inside.assign((size_t)width * height, false);
+    double ns = measure(iterations, [&]() {
+        uint64_t covered = 0;
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                bool in = triangle.pointInTriangle({ T((int)x), T((int)y), T(0) });
+                inside[(size_t)y * width + x] = in;
+                covered += in;
+            }
+        }
+        sink = covered;
+    });
+    diff = 0;
+    if (reference) {
+        for (size_t i = 0; i < inside.size(); i++) {
+            diff += inside[i] != (*reference)[i];
+        }
+    }
+    return ns / ((double)width * height);
+}
+
+int main(int argc, char **argv) {
+    uint32_t nr_of_vertices = argc > 1 ? std::atoi(argv[1]) : 300000;
+    uint32_t iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+    uint32_t width = argc > 3 ? std::atoi(argv[3]) : 1920;
+    uint32_t height = argc > 4 ? std::atoi(argv[4]) : 1080;
+    uint32_t frames = std::max(1U, iterations / 20);
+
+    double t_double = transformRun<double>(nr_of_vertices, iterations);
+    double t_float = transformRun<float>(nr_of_vertices, iterations);
+    double t_fixed = transformRun<szilv::Fixed>(nr_of_vertices, iterations);
+
+    std::vector<bool> in_double, in_float, in_fixed;
+    uint64_t diff_double, diff_float, diff_fixed;
+    double p_double = insideRun<double>(width, height, frames, nullptr, in_double, diff_double);
+    double p_float = insideRun<float>(width, height, frames, &in_double, in_float, diff_float);
+    double p_fixed = insideRun<szilv::Fixed>(width, height, frames, &in_double, in_fixed, diff_fixed);
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "batch rotation, " << nr_of_vertices << " vertices, ns/vertex, "
+        << szilv::VertexBuffer2DF::getPathName() << std::endl;
+    std::cout << "  double  " << t_double << std::endl;
+    std::cout << "  float   " << t_float << "  (" << t_double / t_float << "x)" << std::endl;
+    std::cout << "  Fixed   " << t_fixed << "  (" << t_double / t_fixed << "x)" << std::endl;
+    std::cout << "pointInTriangle, " << width << "x" << height << ", ns/pixel" << std::endl;
+    std::cout << "  double  " << p_double << std::endl;
+    std::cout << "  float   " << p_float << "  (" << p_double / p_float << "x), "
+        << diff_float << " pixels differ" << std::endl;
+    std::cout << "  Fixed   " << p_fixed << "  (" << p_double / p_fixed << "x), "
+        << diff_fixed << " pixels differ" << std::endl;
+
+    return 0;
+}
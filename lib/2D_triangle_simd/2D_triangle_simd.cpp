@@ -0,0 +1,227 @@
+#include <algorithm>
+#include "2D_triangle_simd.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TRIANGLE_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace szilv {
+
+    // everything of the three edge functions that is constant along one row
+    typedef struct {
+        double ey[3];
+        double vx[3];
+        double t2[3];
+    } RowSetup;
+
+    typedef void (*RowKernel)(const RowSetup & s, uint32_t * row, int32_t x1, int32_t x2,
+            uint32_t color, uint32_t bg_color);
+
+    /**
+     * Same expression as BaseGeometry::sign(point, u, v) and the same decision as Triangle2D::pointInTriangle
+     */
+    static void fillRowScalar(const RowSetup & s, uint32_t * row, int32_t x1, int32_t x2,
+            uint32_t color, uint32_t bg_color) {
+        for (int32_t x = x1; x <= x2; x++) {
+            bool has_neg = false;
+            bool has_pos = false;
+            for (int32_t i = 0; i < 3; i++) {
+                double d = ((double)x - s.vx[i]) * s.ey[i] - s.t2[i];
+                has_neg = has_neg || (d < 0);
+                has_pos = has_pos || (d > 0);
+            }
+            row[x] = !(has_neg && has_pos) ? color : bg_color;
+        }
+    }
+
+#if defined(TRIANGLE_SIMD_X86)
+    /**
+     * 8 pixels per iteration as two vectors of 4 doubles, the tail is written with a masked store
+     */
+    __attribute__((target("avx2")))
+    static void fillRowAVX2(const RowSetup & s, uint32_t * row, int32_t x1, int32_t x2,
+            uint32_t color, uint32_t bg_color) {
+        const __m256d lanes = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+        const __m256d four = _mm256_set1_pd(4.0);
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256i bits = _mm256_set_epi32(128, 64, 32, 16, 8, 4, 2, 1);
+        const __m256i lane_idx = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+        const __m256i vcolor = _mm256_set1_epi32((int32_t)color);
+        const __m256i vbg = _mm256_set1_epi32((int32_t)bg_color);
+        __m256d vx[3], ey[3], t2[3];
+        for (int32_t i = 0; i < 3; i++) {
+            vx[i] = _mm256_set1_pd(s.vx[i]);
+            ey[i] = _mm256_set1_pd(s.ey[i]);
+            t2[i] = _mm256_set1_pd(s.t2[i]);
+        }
+
+        for (int32_t x = x1; x <= x2; x += 8) {
+            __m256d px[2];
+            px[0] = _mm256_add_pd(_mm256_set1_pd((double)x), lanes);
+            px[1] = _mm256_add_pd(px[0], four);
+
+            int32_t outside = 0;
+            for (int32_t h = 0; h < 2; h++) {
+                __m256d neg = zero;
+                __m256d pos = zero;
+                for (int32_t i = 0; i < 3; i++) {
+                    __m256d d = _mm256_sub_pd(_mm256_mul_pd(_mm256_sub_pd(px[h], vx[i]), ey[i]), t2[i]);
+                    neg = _mm256_or_pd(neg, _mm256_cmp_pd(d, zero, _CMP_LT_OQ));
+                    pos = _mm256_or_pd(pos, _mm256_cmp_pd(d, zero, _CMP_GT_OQ));
+                }
+                outside |= _mm256_movemask_pd(_mm256_and_pd(neg, pos)) << (4 * h);
+            }
+
+            // expand the 8 coverage bits to 32-bit lanes and select the colors
+            __m256i inside = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(~outside), bits), bits);
+            __m256i out = _mm256_blendv_epi8(vbg, vcolor, inside);
+
+            int32_t left = x2 - x + 1;
+            if (left >= 8) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + x), out);
+            } else {
+                __m256i tail = _mm256_cmpgt_epi32(_mm256_set1_epi32(left), lane_idx);
+                _mm256_maskstore_epi32(reinterpret_cast<int*>(row + x), tail, out);
+            }
+        }
+    }
+
+    /**
+     * 4 pixels per iteration as two vectors of 2 doubles, the tail goes through the scalar path
+     */
+    __attribute__((target("sse4.1")))
+    static void fillRowSSE4(const RowSetup & s, uint32_t * row, int32_t x1, int32_t x2,
+            uint32_t color, uint32_t bg_color) {
+        const __m128d lanes = _mm_set_pd(1.0, 0.0);
+        const __m128d two = _mm_set1_pd(2.0);
+        const __m128d zero = _mm_setzero_pd();
+        const __m128i bits = _mm_set_epi32(8, 4, 2, 1);
+        const __m128i vcolor = _mm_set1_epi32((int32_t)color);
+        const __m128i vbg = _mm_set1_epi32((int32_t)bg_color);
+        __m128d vx[3], ey[3], t2[3];
+        for (int32_t i = 0; i < 3; i++) {
+            vx[i] = _mm_set1_pd(s.vx[i]);
+            ey[i] = _mm_set1_pd(s.ey[i]);
+            t2[i] = _mm_set1_pd(s.t2[i]);
+        }
+
+        int32_t x = x1;
+        for (; x + 3 <= x2; x += 4) {
+            __m128d px[2];
+            px[0] = _mm_add_pd(_mm_set1_pd((double)x), lanes);
+            px[1] = _mm_add_pd(px[0], two);
+
+            int32_t outside = 0;
+            for (int32_t h = 0; h < 2; h++) {
+                __m128d neg = zero;
+                __m128d pos = zero;
+                for (int32_t i = 0; i < 3; i++) {
+                    __m128d d = _mm_sub_pd(_mm_mul_pd(_mm_sub_pd(px[h], vx[i]), ey[i]), t2[i]);
+                    neg = _mm_or_pd(neg, _mm_cmplt_pd(d, zero));
+                    pos = _mm_or_pd(pos, _mm_cmpgt_pd(d, zero));
+                }
+                outside |= _mm_movemask_pd(_mm_and_pd(neg, pos)) << (2 * h);
+            }
+
+            __m128i inside = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(~outside), bits), bits);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), _mm_blendv_epi8(vbg, vcolor, inside));
+        }
+        fillRowScalar(s, row, x, x2, color, bg_color);
+    }
+#endif
+
+    static FillKernelPath detectPath() {
+#if defined(TRIANGLE_SIMD_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return FillKernelAVX2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return FillKernelSSE4;
+        }
+#endif
+        return FillKernelScalar;
+    }
+
+    static RowKernel kernelFor(FillKernelPath path) {
+        switch (path) {
+#if defined(TRIANGLE_SIMD_X86)
+            case FillKernelAVX2: return fillRowAVX2;
+            case FillKernelSSE4: return fillRowSSE4;
+#endif
+            default: return fillRowScalar;
+        }
+    }
+
+    static FillKernelPath & activePath() {
+        static FillKernelPath path = detectPath();
+        return path;
+    }
+
+    static RowKernel & activeKernel() {
+        static RowKernel kernel = kernelFor(activePath());
+        return kernel;
+    }
+
+    FillKernelPath TriangleFillSimd2D::getPath() {
+        return activePath();
+    }
+
+    bool TriangleFillSimd2D::setPath(FillKernelPath path) {
+        // every CPU with AVX2 has SSE4.1 too, so the detected path is the widest usable one
+        if (path > detectPath()) {
+            return false;
+        }
+        activePath() = path;
+        activeKernel() = kernelFor(path);
+        return true;
+    }
+
+    const char * TriangleFillSimd2D::getPathName() {
+        switch (getPath()) {
+            case FillKernelAVX2: return "avx2";
+            case FillKernelSSE4: return "sse4.1";
+            default: return "scalar";
+        }
+    }
+
+    TriangleFillSimd2D::TriangleFillSimd2D() {
+        setPrimitive({ {0, 0, 0}, {0, 0, 0}, {0, 0, 0} });
+    }
+
+    TriangleFillSimd2D::TriangleFillSimd2D(TrianglePrimitive trg_prm) {
+        setPrimitive(trg_prm);
+    }
+
+    void TriangleFillSimd2D::setPrimitive(TrianglePrimitive trg_prm) {
+        Vertex us[3] = { trg_prm.p1, trg_prm.p2, trg_prm.p3 };
+        Vertex vs[3] = { trg_prm.p2, trg_prm.p3, trg_prm.p1 };
+        for (int32_t i = 0; i < 3; i++) {
+            ex[i] = us[i].x - vs[i].x;
+            ey[i] = us[i].y - vs[i].y;
+            vx[i] = vs[i].x;
+            vy[i] = vs[i].y;
+        }
+    }
+
+    void TriangleFillSimd2D::fillRow(uint32_t * row, int32_t y, int32_t x1, int32_t x2,
+            uint32_t color, uint32_t bg_color) const {
+        RowKernel kernel = activeKernel();
+        RowSetup s;
+        for (int32_t i = 0; i < 3; i++) {
+            s.ey[i] = ey[i];
+            s.vx[i] = vx[i];
+            s.t2[i] = ex[i] * ((double)y - vy[i]);
+        }
+        kernel(s, row, x1, x2, color, bg_color);
+    }
+
+    void TriangleFillSimd2D::fillRows(uint8_t * target_buff, uint32_t pitch, SquareDefinition square,
+            uint32_t color, uint32_t bg_color) const {
+        for (int32_t y = square.y1; y <= square.y2; y++) {
+            uint32_t * row = reinterpret_cast<uint32_t*>(target_buff + (y * pitch));
+            fillRow(row, y, square.x1, square.x2, color, bg_color);
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#if !defined(TRIANGLE_SIMD_2D_H)
+#define TRIANGLE_SIMD_2D_H
+
+#include <cstdint>
+#include "base_geometry.hpp"
+#include "2D_triangle.hpp"
+
+namespace szilv {
+
+    enum FillKernelPath {
+        FillKernelScalar,
+        FillKernelSSE4,
+        FillKernelAVX2
+    };
+
+    // the per-pixel coverage test of Triangle2D::pointInTriangle, evaluated for 8 (AVX2) or 4 (SSE4.1)
+    // pixels at once. The edge functions are computed in double with the same operation order, so the
+    // output is bit-exact with the scalar test.
+    class TriangleFillSimd2D {
+        public:
+            TriangleFillSimd2D();
+            TriangleFillSimd2D(TrianglePrimitive trg_prm);
+
+            virtual void setPrimitive(TrianglePrimitive trg_prm);
+
+            // writes color to the covered pixels and bg_color to the rest of [x1, x2] of row y
+            void fillRow(uint32_t * row, int32_t y, int32_t x1, int32_t x2, uint32_t color, uint32_t bg_color) const;
+            void fillRows(uint8_t * target_buff, uint32_t pitch, SquareDefinition square,
+                    uint32_t color, uint32_t bg_color) const;
+
+            // the widest path the running CPU supports, picked once at startup
+            static FillKernelPath getPath();
+            // pins the kernel to a narrower path, false if the running CPU does not support it. Not thread
+            // safe, meant for the coverage test and benchmarks before any drawing starts
+            static bool setPath(FillKernelPath path);
+            static const char * getPathName();
+
+        private:
+            // u.x - v.x, u.y - v.y and v of each edge, in the order pointInTriangle passes them to sign()
+            double ex[3];
+            double ey[3];
+            double vx[3];
+            double vy[3];
+    };
+}
+
+#endif /* !defined(TRIANGLE_SIMD_2D_H) */
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <algorithm>
+#include <vector>
+
+#include "base_geometry.hpp"
+#include "2D_triangle.hpp"
+#include "2D_triangle_simd.hpp"
+
+/**
+ * Checks TriangleFillSimd2D bit-exact against Triangle2D::pointInTriangle: random triangles, including
+ * degenerate and sub-pixel ones, are filled with every kernel path the CPU supports and the coverage
+ * is compared pixel by pixel with the scalar test. Rows start at every alignment so the SIMD tails are
+ * exercised too. Exits with 1 on the first mismatching pixel.
+ *
+ * usage: 2D_triangle_simd_coverage_test [triangles] [seed]
+ */
+
+static const int32_t width = 67;
+static const int32_t height = 41;
+static const uint32_t color = 0x00ffffff;
+static const uint32_t bg_color = 0x00000000;
+
+static szilv::TrianglePrimitive randomTriangle(std::mt19937 & rng, uint32_t i) {
+    std::uniform_real_distribution<double> px(-8.0, width + 8.0);
+    std::uniform_real_distribution<double> py(-8.0, height + 8.0);
+    szilv::TrianglePrimitive tr = { { px(rng), py(rng), 0 }, { px(rng), py(rng), 0 }, { px(rng), py(rng), 0 } };
+    switch (i % 4) {
+        case 1:
+            // integer vertices, the edges go exactly through pixel centers
+            tr.p1 = { (double)(int32_t)tr.p1.x, (double)(int32_t)tr.p1.y, 0 };
+            tr.p2 = { (double)(int32_t)tr.p2.x, (double)(int32_t)tr.p2.y, 0 };
+            tr.p3 = { (double)(int32_t)tr.p3.x, (double)(int32_t)tr.p3.y, 0 };
+            break;
+        case 2:
+            // degenerate, all three vertices on one line
+            tr.p3 = { (tr.p1.x + tr.p2.x) * 0.5, (tr.p1.y + tr.p2.y) * 0.5, 0 };
+            break;
+        case 3:
+            // smaller than a pixel
+            tr.p2 = { tr.p1.x + 0.3, tr.p1.y + 0.1, 0 };
+            tr.p3 = { tr.p1.x - 0.2, tr.p1.y + 0.4, 0 };
+            break;
+    }
+    return tr;
+}
+
+static bool checkPath(szilv::FillKernelPath path, uint32_t triangles, uint32_t seed) {
+    if (!szilv::TriangleFillSimd2D::setPath(path)) {
+        return true;
+    }
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> row(width);
+    for (uint32_t i = 0; i < triangles; i++) {
+        szilv::TrianglePrimitive tr = randomTriangle(rng, i);
+        szilv::Triangle2D reference(tr);
+        szilv::TriangleFillSimd2D simd(tr);
+        for (int32_t y = 0; y < height; y++) {
+            int32_t x1 = (int32_t)(i % 9);
+            int32_t x2 = width - 1 - (int32_t)(i % 7);
+            std::fill(row.begin(), row.end(), 0xdeadbeef);
+            simd.fillRow(row.data(), y, x1, x2, color, bg_color);
+            for (int32_t x = 0; x < width; x++) {
+                uint32_t expected = 0xdeadbeef;
+                if (x >= x1 && x <= x2) {
+                    expected = reference.pointInTriangle({ (double)x, (double)y, 0 }) ? color : bg_color;
+                }
+                if (row[x] != expected) {
+                    std::cerr << szilv::TriangleFillSimd2D::getPathName() << ": triangle " << i
+                        << " pixel (" << x << ", " << y << ") is " << std::hex << row[x]
+                        << ", pointInTriangle gives " << expected << std::dec << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    std::cout << szilv::TriangleFillSimd2D::getPathName() << ": " << triangles << " triangles match" << std::endl;
+    return true;
+}
+
+int main(int argc, char ** argv) {
+    uint32_t triangles = argc > 1 ? atoi(argv[1]) : 2000;
+    uint32_t seed = argc > 2 ? atoi(argv[2]) : 1;
+
+    bool ok = true;
+    ok = checkPath(szilv::FillKernelScalar, triangles, seed) && ok;
+    ok = checkPath(szilv::FillKernelSSE4, triangles, seed) && ok;
+    ok = checkPath(szilv::FillKernelAVX2, triangles, seed) && ok;
+    return ok ? 0 : 1;
+}
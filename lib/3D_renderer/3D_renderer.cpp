@@ -0,0 +1,317 @@
+#include <cmath>
+#include <algorithm>
+
+#include "3D_renderer.hpp"
+#include "trace.hpp"
+
+namespace szilv {
+
+    // vertices per vertex task and triangles per setup task
+    static const uint32_t VERTEX_CHUNK = 1024;
+    static const uint32_t TRIANGLE_CHUNK = 256;
+
+    void VertexTask3D::run(uint32_t) {
+        TraceScope trace("Vertex3D", "Renderer3D", "first", first);
+        renderer->transformVertices(first, count);
+    }
+
+    void SetupTask3D::run(uint32_t) {
+        TraceScope trace("Setup3D", "Renderer3D", "first", first);
+        renderer->setupTriangles(index, first, count);
+    }
+
+    void RasterTask3D::run(uint32_t) {
+        TraceScope trace("Raster3D", "Renderer3D", "strip", strip);
+        renderer->rasterStrip(strip);
+    }
+
+    Renderer3D::Renderer3D(ThreadPool * pool, uint32_t width, uint32_t height, uint32_t strip_rows)
+        : pool(pool), width(width), height(height), strip_rows(std::max(1U, strip_rows)),
+        depth((size_t)width * height, 1.0f) {
+        nr_of_strips = (height + this->strip_rows - 1) / this->strip_rows;
+        for (uint32_t i = 0; i < nr_of_strips; i++) {
+            raster_tasks.push_back(RasterTask3D(this, i));
+        }
+    }
+
+    void Renderer3D::setLight(Vertex direction) {
+        double length = sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+        if (length > 0) {
+            light = { direction.x / length, direction.y / length, direction.z / length };
+        }
+    }
+
+    uint32_t Renderer3D::getNrOfDrawnTriangles() const {
+        uint32_t drawn = 0;
+        for (uint32_t i = 0; i < setup_tasks.size(); i++) {
+            drawn += triangles[i].size();
+        }
+        return drawn;
+    }
+
+    uint32_t Renderer3D::getNrOfClippedTriangles() const {
+        uint32_t nr_of_clipped = 0;
+        for (uint32_t i = 0; i < setup_tasks.size(); i++) {
+            nr_of_clipped += clipped[i];
+        }
+        return nr_of_clipped;
+    }
+
+    /**
+     * one wait per phase, the setup needs every vertex and the raster every bin
+     */
+    void Renderer3D::render(const Mesh3D & mesh, const Mat4 & model, const Mat4 & view_projection,
+            uint8_t * target_buff, uint32_t pitch) {
+        this->mesh = &mesh;
+        this->model = model;
+        this->mvp = Matrix::multiply(view_projection, model);
+        this->target_buff = target_buff;
+        this->pitch = pitch;
+
+        uint32_t nr_of_vertices = mesh.getNrOfVertices();
+        cx.resize(nr_of_vertices);
+        cy.resize(nr_of_vertices);
+        cz.resize(nr_of_vertices);
+        cw.resize(nr_of_vertices);
+        vertex_tasks.clear();
+        for (uint32_t first = 0; first < nr_of_vertices; first += VERTEX_CHUNK) {
+            vertex_tasks.push_back(VertexTask3D(this, first, std::min(VERTEX_CHUNK, nr_of_vertices - first)));
+        }
+        for (auto & task : vertex_tasks) {
+            pool->submit(&task);
+        }
+        pool->wait();
+
+        uint32_t nr_of_triangles = mesh.getNrOfTriangles();
+        uint32_t nr_of_setup_tasks = (nr_of_triangles + TRIANGLE_CHUNK - 1) / TRIANGLE_CHUNK;
+        if (triangles.size() < nr_of_setup_tasks) {
+            triangles.resize(nr_of_setup_tasks);
+            bins.resize(nr_of_setup_tasks, std::vector<std::vector<uint32_t>>(nr_of_strips));
+            clipped.resize(nr_of_setup_tasks);
+        }
+        setup_tasks.clear();
+        for (uint32_t i = 0; i < nr_of_setup_tasks; i++) {
+            uint32_t first = i * TRIANGLE_CHUNK;
+            setup_tasks.push_back(SetupTask3D(this, i, first, std::min(TRIANGLE_CHUNK, nr_of_triangles - first)));
+        }
+        for (auto & task : setup_tasks) {
+            pool->submit(&task);
+        }
+        pool->wait();
+
+        for (auto & task : raster_tasks) {
+            pool->submit(&task);
+        }
+        pool->wait();
+    }
+
+    void Renderer3D::transformVertices(uint32_t first, uint32_t count) {
+        Matrix::apply(mvp, mesh->xs.data() + first, mesh->ys.data() + first, mesh->zs.data() + first,
+                cx.data() + first, cy.data() + first, cz.data() + first, cw.data() + first, count);
+    }
+
+    /**
+     * flat shading with the normal turned by the model matrix (rotation and uniform scale), then clipping
+     * and binning
+     */
+    void Renderer3D::setupTriangles(uint32_t index, uint32_t first, uint32_t count) {
+        std::vector<ScreenTriangle3D> & out = triangles[index];
+        std::vector<std::vector<uint32_t>> & strip_bins = bins[index];
+        out.clear();
+        for (auto & bin : strip_bins) {
+            bin.clear();
+        }
+        clipped[index] = 0;
+
+        const double * m = model.m;
+        uint32_t color = mesh->getColor();
+        for (uint32_t t = first; t < first + count; t++) {
+            const uint32_t * idx = &mesh->indices[t * 3];
+            Vertex4 clip[3];
+            bool near_clipped = false;
+            for (int i = 0; i < 3; i++) {
+                clip[i] = { cx[idx[i]], cy[idx[i]], cz[idx[i]], cw[idx[i]] };
+                near_clipped = near_clipped || clip[i].z + clip[i].w < 0;
+            }
+
+            Vertex n = mesh->normals[t];
+            double nx = m[0] * n.x + m[1] * n.y + m[2] * n.z;
+            double ny = m[4] * n.x + m[5] * n.y + m[6] * n.z;
+            double nz = m[8] * n.x + m[9] * n.y + m[10] * n.z;
+            double length = sqrt(nx * nx + ny * ny + nz * nz);
+            double lambert = length > 0 ? (nx * light.x + ny * light.y + nz * light.z) / length : 0;
+            double intensity = 0.15 + 0.85 * std::max(0.0, lambert);
+            uint32_t shaded =
+                (uint32_t)(((color >> 16) & 0xFF) * intensity) << 16 |
+                (uint32_t)(((color >> 8) & 0xFF) * intensity) << 8 |
+                (uint32_t)((color & 0xFF) * intensity);
+
+            uint32_t first_new = out.size();
+            uint32_t nr_of_new = clipTriangle(clip, width, height, culling, shaded, out);
+            if (near_clipped && nr_of_new) {
+                clipped[index]++;
+            }
+            for (uint32_t k = first_new; k < first_new + nr_of_new; k++) {
+                // the rows the top-left rule gives the triangle, clamped to the screen
+                double row1 = std::max(std::ceil(out[k].y[0] - 0.5), 0.0);
+                double row2 = std::min(std::ceil(out[k].y[2] - 0.5) - 1, height - 1.0);
+                if (row1 > row2) {
+                    continue;
+                }
+                for (uint32_t s = (uint32_t)row1 / strip_rows; s <= (uint32_t)row2 / strip_rows; s++) {
+                    strip_bins[s].push_back(k);
+                }
+            }
+        }
+    }
+
+    void Renderer3D::rasterStrip(uint32_t strip) {
+        int32_t y1 = strip * strip_rows;
+        int32_t y2 = std::min(y1 + (int32_t)strip_rows - 1, (int32_t)height - 1);
+        for (int32_t y = y1; y <= y2; y++) {
+            uint32_t * row = (uint32_t *)(target_buff + (size_t)y * pitch);
+            std::fill(row, row + width, bg_color);
+            std::fill(&depth[(size_t)y * width], &depth[(size_t)y * width] + width, 1.0f);
+        }
+        // in setup order, so equal depths resolve the same way every frame
+        for (uint32_t i = 0; i < setup_tasks.size(); i++) {
+            for (uint32_t k : bins[i][strip]) {
+                rasterTriangle(triangles[i][k], y1, y2, width, target_buff, pitch, depth.data());
+            }
+        }
+    }
+
+    /**
+     * the point where the edge from inside to outside crosses the near plane (z = -w). Both triangles
+     * sharing the edge compute it in the same direction, so they get the same vertex
+     */
+    static Vertex4 nearIntersection(const Vertex4 & in, const Vertex4 & out) {
+        double d_in = in.z + in.w;
+        double d_out = out.z + out.w;
+        double t = d_in / (d_in - d_out);
+        return {
+            in.x + t * (out.x - in.x),
+            in.y + t * (out.y - in.y),
+            in.z + t * (out.z - in.z),
+            in.w + t * (out.w - in.w)
+        };
+    }
+
+    /**
+     * perspective divide, viewport, culling and the depth plane of one triangle in front of the near plane
+     */
+    static uint32_t emitTriangle(const Vertex4 & a, const Vertex4 & b, const Vertex4 & c, uint32_t width,
+            uint32_t height, bool culling, uint32_t color, std::vector<ScreenTriangle3D> & out) {
+        const Vertex4 * clip[3] = { &a, &b, &c };
+        double x[3], y[3], z[3];
+        for (int i = 0; i < 3; i++) {
+            x[i] = (clip[i]->x / clip[i]->w * 0.5 + 0.5) * width;
+            y[i] = (0.5 - clip[i]->y / clip[i]->w * 0.5) * height;
+            z[i] = clip[i]->z / clip[i]->w * 0.5 + 0.5;
+        }
+        // counter-clockwise in normalized device coordinates is clockwise with y pointing down
+        double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (area == 0 || (culling && area > 0)) {
+            return 0;
+        }
+
+        int order[3] = { 0, 1, 2 };
+        std::sort(order, order + 3, [&y](int i, int j) { return y[i] < y[j]; });
+        ScreenTriangle3D t;
+        for (int i = 0; i < 3; i++) {
+            t.x[i] = x[order[i]];
+            t.y[i] = y[order[i]];
+        }
+        t.z0 = z[order[0]];
+        t.dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+        t.dzdy = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / area;
+        t.color = color;
+        out.push_back(t);
+        return 1;
+    }
+
+    uint32_t Renderer3D::clipTriangle(const Vertex4 clip[3], uint32_t width, uint32_t height, bool culling,
+            uint32_t color, std::vector<ScreenTriangle3D> & out) {
+        // entirely outside one of the other planes of the frustum
+        if ((clip[0].x > clip[0].w && clip[1].x > clip[1].w && clip[2].x > clip[2].w) ||
+                (clip[0].x < -clip[0].w && clip[1].x < -clip[1].w && clip[2].x < -clip[2].w) ||
+                (clip[0].y > clip[0].w && clip[1].y > clip[1].w && clip[2].y > clip[2].w) ||
+                (clip[0].y < -clip[0].w && clip[1].y < -clip[1].w && clip[2].y < -clip[2].w) ||
+                (clip[0].z > clip[0].w && clip[1].z > clip[1].w && clip[2].z > clip[2].w)) {
+            return 0;
+        }
+
+        // Sutherland-Hodgman against z >= -w, at most 4 vertices come out
+        Vertex4 polygon[4];
+        uint32_t nr_of_vertices = 0;
+        for (int i = 0; i < 3; i++) {
+            const Vertex4 & current = clip[i];
+            const Vertex4 & next = clip[(i + 1) % 3];
+            bool current_in = current.z + current.w >= 0;
+            bool next_in = next.z + next.w >= 0;
+            if (current_in) {
+                polygon[nr_of_vertices++] = current;
+            }
+            if (current_in != next_in) {
+                polygon[nr_of_vertices++] = current_in ? nearIntersection(current, next) : nearIntersection(next, current);
+            }
+        }
+        if (nr_of_vertices < 3) {
+            return 0;
+        }
+
+        uint32_t nr_of_triangles = emitTriangle(polygon[0], polygon[1], polygon[2], width, height, culling, color, out);
+        if (nr_of_vertices == 4) {
+            nr_of_triangles += emitTriangle(polygon[0], polygon[2], polygon[3], width, height, culling, color, out);
+        }
+        return nr_of_triangles;
+    }
+
+    /**
+     * Scanline fill between the long edge (top to bottom) and the two short ones. A pixel is covered when
+     * its center is on or right of the left edge and left of the right one, and its row center is on or
+     * below the top and above the bottom. The x of an edge comes from its top vertex and slope, the same
+     * numbers for both triangles sharing it. Rasterizer2D is not reused, it samples at the integer
+     * coordinates with the edge rule of pointInTriangle, the pixel centers here are at +0.5.
+     */
+    void Renderer3D::rasterTriangle(const ScreenTriangle3D & t, int32_t y1, int32_t y2, uint32_t width,
+            uint8_t * target_buff, uint32_t pitch, float * depth) {
+        const double ax = t.x[0], ay = t.y[0];
+        const double bx = t.x[1], by = t.y[1];
+        const double cx = t.x[2], cy = t.y[2];
+        double row1 = std::max(std::ceil(ay - 0.5), (double)y1);
+        double row2 = std::min(std::ceil(cy - 0.5) - 1, (double)y2);
+        if (row1 > row2) {
+            return;
+        }
+        const double slope_ac = (cx - ax) / (cy - ay);
+        const double slope_ab = by > ay ? (bx - ax) / (by - ay) : 0;
+        const double slope_bc = cy > by ? (cx - bx) / (cy - by) : 0;
+        const double last_x = width - 1.0;
+
+        for (int32_t y = (int32_t)row1; y <= (int32_t)row2; y++) {
+            double yc = y + 0.5;
+            double x_long = ax + (yc - ay) * slope_ac;
+            double x_short = yc < by ? ax + (yc - ay) * slope_ab : bx + (yc - by) * slope_bc;
+            double left = std::max(std::ceil(std::min(x_long, x_short) - 0.5), 0.0);
+            double right = std::min(std::ceil(std::max(x_long, x_short) - 0.5) - 1, last_x);
+            if (left > right) {
+                continue;
+            }
+            int32_t x1 = (int32_t)left;
+            int32_t x2 = (int32_t)right;
+
+            uint32_t * row = (uint32_t *)(target_buff + (size_t)y * pitch);
+            float * depth_row = depth + (size_t)y * width;
+            // stepped along the row, the plane is evaluated once per row
+            float z = t.z0 + t.dzdx * (float)(x1 + 0.5 - ax) + t.dzdy * (float)(yc - ay);
+            for (int32_t x = x1; x <= x2; x++) {
+                if (z < depth_row[x]) {
+                    depth_row[x] = z;
+                    row[x] = t.color;
+                }
+                z += t.dzdx;
+            }
+        }
+    }
+}
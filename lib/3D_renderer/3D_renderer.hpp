@@ -0,0 +1,136 @@
+#if !defined(RENDERER_3D_H)
+#define RENDERER_3D_H
+
+#include <cstdint>
+#include <vector>
+
+#include "base_geometry.hpp"
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+#include "mesh_3D.hpp"
+
+namespace szilv {
+
+    // a triangle after clipping, perspective divide and viewport mapping: pixel coordinates with the
+    // pixel centers at +0.5, sorted top to bottom, and the depth (0 near, 1 far) as a plane over the screen
+    typedef struct {
+        double x[3];
+        double y[3];
+        float z0;       // depth at (x[0], y[0])
+        float dzdx;
+        float dzdy;
+        uint32_t color;
+    } ScreenTriangle3D;
+
+    class Renderer3D;
+
+    // the three phases of a frame, each one a batch of pool tasks with a wait in between
+    class VertexTask3D : public PoolTask {
+        public:
+            VertexTask3D(Renderer3D * renderer, uint32_t first, uint32_t count)
+                : renderer(renderer), first(first), count(count) {}
+            void run(uint32_t worker_id) override;
+
+        private:
+            Renderer3D * renderer;
+            uint32_t first;
+            uint32_t count;
+    };
+
+    class SetupTask3D : public PoolTask {
+        public:
+            SetupTask3D(Renderer3D * renderer, uint32_t index, uint32_t first, uint32_t count)
+                : renderer(renderer), index(index), first(first), count(count) {}
+            void run(uint32_t worker_id) override;
+
+        private:
+            Renderer3D * renderer;
+            uint32_t index;
+            uint32_t first;
+            uint32_t count;
+    };
+
+    class RasterTask3D : public PoolTask {
+        public:
+            RasterTask3D(Renderer3D * renderer, uint32_t strip) : renderer(renderer), strip(strip) {}
+            void run(uint32_t worker_id) override;
+
+        private:
+            Renderer3D * renderer;
+            uint32_t strip;
+    };
+
+    // Software 3D pipeline on the ThreadPool:
+    //  - vertex: the model-view-projection matrix over chunks of the mesh positions, to clip space
+    //  - setup: chunks of triangles are clipped against the near plane (a triangle becomes 0, 1 or 2),
+    //    divided by w, mapped to the viewport, back face culled, flat shaded and binned into the strips
+    //    of rows they cover
+    //  - raster: one task per strip clears its rows and fills the triangles of its bins with a depth test
+    //    against a 32 bit float depth buffer, the depth is stepped by dz/dx along the row
+    // Every phase writes disjoint memory, the strips own their rows of the color and the depth buffer.
+    // The edges follow the top-left rule, so triangles sharing an edge neither overlap nor leave gaps.
+    class Renderer3D {
+        public:
+            Renderer3D(ThreadPool * pool, uint32_t width, uint32_t height, uint32_t strip_rows = 16);
+
+            // clears target_buff (XRGB8888, pitch bytes per row) and the depth buffer, then draws the mesh
+            virtual void render(const Mesh3D & mesh, const Mat4 & model, const Mat4 & view_projection,
+                    uint8_t * target_buff, uint32_t pitch);
+
+            // world space direction towards the light
+            void setLight(Vertex direction);
+            void setCulling(bool back_face_culling) { culling = back_face_culling; }
+            void setBackground(uint32_t color) { bg_color = color; }
+            const float * getDepth() const { return depth.data(); }
+
+            // of the last frame
+            uint32_t getNrOfDrawnTriangles() const;
+            uint32_t getNrOfClippedTriangles() const;
+
+            // near plane clipping, divide and viewport of one triangle in clip space. Appends 0, 1 or 2
+            // triangles to out, returns how many
+            static uint32_t clipTriangle(const Vertex4 clip[3], uint32_t width, uint32_t height, bool culling,
+                    uint32_t color, std::vector<ScreenTriangle3D> & out);
+            // the rows [y1, y2] of t, color and depth rows are pitch and width elements long
+            static void rasterTriangle(const ScreenTriangle3D & t, int32_t y1, int32_t y2, uint32_t width,
+                    uint8_t * target_buff, uint32_t pitch, float * depth);
+
+        private:
+            ThreadPool * pool;
+            uint32_t width;
+            uint32_t height;
+            uint32_t strip_rows;
+            uint32_t nr_of_strips;
+            bool culling = true;
+            uint32_t bg_color = 0x0;
+            Vertex light = { 0, 0, 1 };
+            std::vector<float> depth;
+
+            // the frame being drawn, valid during render()
+            const Mesh3D * mesh = nullptr;
+            Mat4 model;
+            Mat4 mvp;
+            uint8_t * target_buff = nullptr;
+            uint32_t pitch = 0;
+            // clip space positions of the mesh
+            std::vector<double> cx, cy, cz, cw;
+            // per setup task: its triangles and, per strip, the indices of the ones that touch it
+            std::vector<std::vector<ScreenTriangle3D>> triangles;
+            std::vector<std::vector<std::vector<uint32_t>>> bins;
+            std::vector<uint32_t> clipped;
+
+            std::vector<VertexTask3D> vertex_tasks;
+            std::vector<SetupTask3D> setup_tasks;
+            std::vector<RasterTask3D> raster_tasks;
+
+            void transformVertices(uint32_t first, uint32_t count);
+            void setupTriangles(uint32_t index, uint32_t first, uint32_t count);
+            void rasterStrip(uint32_t strip);
+
+            friend class VertexTask3D;
+            friend class SetupTask3D;
+            friend class RasterTask3D;
+    };
+}
+
+#endif /* !defined(RENDERER_3D_H) */
@@ -0,0 +1,60 @@
+#include <cmath>
+
+#include "mesh_3D.hpp"
+
+namespace szilv {
+
+    Mesh3D::Mesh3D(uint32_t color) : color(color) {}
+
+    uint32_t Mesh3D::addVertex(Vertex v) {
+        xs.push_back(v.x);
+        ys.push_back(v.y);
+        zs.push_back(v.z);
+        return xs.size() - 1;
+    }
+
+    void Mesh3D::addTriangle(uint32_t i1, uint32_t i2, uint32_t i3) {
+        indices.push_back(i1);
+        indices.push_back(i2);
+        indices.push_back(i3);
+
+        // (p2 - p1) x (p3 - p1)
+        double ux = xs[i2] - xs[i1], uy = ys[i2] - ys[i1], uz = zs[i2] - zs[i1];
+        double vx = xs[i3] - xs[i1], vy = ys[i3] - ys[i1], vz = zs[i3] - zs[i1];
+        double nx = uy * vz - uz * vy;
+        double ny = uz * vx - ux * vz;
+        double nz = ux * vy - uy * vx;
+        double length = sqrt(nx * nx + ny * ny + nz * nz);
+        if (length > 0) {
+            normals.push_back({ nx / length, ny / length, nz / length });
+        } else {
+            normals.push_back({ 0, 0, 0 });
+        }
+    }
+
+    Mesh3D Mesh3D::torus(double major_radius, double minor_radius, uint32_t rings, uint32_t sides, uint32_t color) {
+        Mesh3D mesh(color);
+        for (uint32_t i = 0; i < rings; i++) {
+            double u = 2 * M_PI * i / rings;
+            for (uint32_t j = 0; j < sides; j++) {
+                double v = 2 * M_PI * j / sides;
+                double r = major_radius + minor_radius * cos(v);
+                mesh.addVertex({ r * cos(u), r * sin(u), minor_radius * sin(v) });
+            }
+        }
+        for (uint32_t i = 0; i < rings; i++) {
+            uint32_t next_i = (i + 1) % rings;
+            for (uint32_t j = 0; j < sides; j++) {
+                uint32_t next_j = (j + 1) % sides;
+                uint32_t a = i * sides + j;
+                uint32_t b = next_i * sides + j;
+                uint32_t c = next_i * sides + next_j;
+                uint32_t d = i * sides + next_j;
+                // counter-clockwise seen from outside the tube
+                mesh.addTriangle(a, b, c);
+                mesh.addTriangle(a, c, d);
+            }
+        }
+        return mesh;
+    }
+}
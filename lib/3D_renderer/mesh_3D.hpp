@@ -0,0 +1,42 @@
+#if !defined(MESH_3D_H)
+#define MESH_3D_H
+
+#include <cstdint>
+#include <vector>
+
+#include "base_geometry.hpp"
+
+namespace szilv {
+
+    // Indexed triangle mesh in model space. The positions are kept as structure of arrays for the batch
+    // transform of Matrix::apply; every triangle is counter-clockwise seen from its front and has a flat
+    // normal, computed when it is added.
+    class Mesh3D {
+        public:
+            Mesh3D(uint32_t color = 0xFFFFFF);
+
+            uint32_t addVertex(Vertex v);
+            void addTriangle(uint32_t i1, uint32_t i2, uint32_t i3);
+
+            uint32_t getNrOfVertices() const { return xs.size(); }
+            uint32_t getNrOfTriangles() const { return indices.size() / 3; }
+            uint32_t getColor() const { return color; }
+
+            // rings around the axis (z) times sides around the tube, 2 triangles each
+            static Mesh3D torus(double major_radius, double minor_radius, uint32_t rings, uint32_t sides,
+                    uint32_t color = 0xFFFFFF);
+
+            std::vector<double> xs;
+            std::vector<double> ys;
+            std::vector<double> zs;
+            // 3 per triangle
+            std::vector<uint32_t> indices;
+            // 1 per triangle, unit length
+            std::vector<Vertex> normals;
+
+        private:
+            uint32_t color;
+    };
+}
+
+#endif /* !defined(MESH_3D_H) */
@@ -3,17 +3,64 @@
 
 namespace szilv {
 
-    double BaseGeometry::sign (Vertex p1, Vertex p2, Vertex p3) {
+    template <typename T>
+    T BasicGeometry<T>::sign (BasicVertex<T> p1, BasicVertex<T> p2, BasicVertex<T> p3) {
         return (p1.x - p3.x) * (p2.y - p3.y) - (p2.x - p3.x) * (p1.y - p3.y);
     }
 
-    Vertex BaseGeometry::rotate2D (Vertex p, Vertex around, double angle) {
-        double x = cos(angle) * (p.x - around.x) - sin(angle) * (p.y - around.y) + around.x;
-        double y = sin(angle) * (p.x - around.x) + cos(angle) * (p.y - around.y) + around.y;
-        return {x, y, 0};
+    template <typename T>
+    BasicVertex<T> BasicGeometry<T>::rotate2D (BasicVertex<T> p, BasicVertex<T> around, double angle) {
+        return rotate2D(p, around, T(cos(angle)), T(sin(angle)));
     }
 
-    Vertex BaseGeometry::translate3D (Vertex p, int32_t x, int32_t y, int32_t z) {
+    template <typename T>
+    BasicVertex<T> BasicGeometry<T>::rotate2D (BasicVertex<T> p, BasicVertex<T> around, T cos_a, T sin_a) {
+        T x = cos_a * (p.x - around.x) - sin_a * (p.y - around.y) + around.x;
+        T y = sin_a * (p.x - around.x) + cos_a * (p.y - around.y) + around.y;
+        return {x, y, T(0)};
+    }
+
+    template <typename T>
+    BasicVertex<T> BasicGeometry<T>::translate3D (BasicVertex<T> p, T x, T y, T z) {
         return {p.x + x, p.y + y, p.z + z};
     }
+
+    template <typename T>
+    FixedVertex BasicGeometry<T>::snapToSubpixel (BasicVertex<T> p) {
+        return {
+            (int32_t)std::lround(static_cast<double>(p.x) * SUBPIXEL_ONE),
+            (int32_t)std::lround(static_cast<double>(p.y) * SUBPIXEL_ONE)
+        };
+    }
+
+    template class BasicGeometry<float>;
+    template class BasicGeometry<double>;
+    template class BasicGeometry<Fixed>;
+
+    Affine2D BaseGeometry::translation2D (double dx, double dy) {
+        return {1, 0, 0, 1, dx, dy};
+    }
+
+    Affine2D BaseGeometry::rotation2D (Vertex around, double angle) {
+        double c = cos(angle);
+        double s = sin(angle);
+        return {c, -s, s, c, around.x - c * around.x + s * around.y, around.y - s * around.x - c * around.y};
+    }
+
+    Affine2D BaseGeometry::scaling2D (Vertex around, double sx, double sy) {
+        return {sx, 0, 0, sy, around.x - sx * around.x, around.y - sy * around.y};
+    }
+
+    Affine2D BaseGeometry::compose2D (const Affine2D & second, const Affine2D & first) {
+        return {
+            second.a * first.a + second.b * first.c, second.a * first.b + second.b * first.d,
+            second.c * first.a + second.d * first.c, second.c * first.b + second.d * first.d,
+            second.a * first.tx + second.b * first.ty + second.tx,
+            second.c * first.tx + second.d * first.ty + second.ty
+        };
+    }
+
+    Vertex BaseGeometry::apply2D (const Affine2D & m, Vertex p) {
+        return {m.a * p.x + m.b * p.y + m.tx, m.c * p.x + m.d * p.y + m.ty, p.z};
+    }
 }
@@ -5,22 +5,100 @@
 
 namespace szilv {
 
-    typedef struct {
-        double x;
-        double y;
-        double z;
-    } Vertex;
+    // 47.16 signed fixed point, the third scalar type of the geometry templates next to float and double.
+    // Products and quotients keep 64 bits, enough for the edge functions of screen sized triangles.
+    class Fixed {
+        public:
+            static const int FRAC_BITS = 16;
+            static const int64_t ONE = (int64_t)1 << FRAC_BITS;
+
+            constexpr Fixed() : raw(0) {}
+            constexpr Fixed(int v) : raw((int64_t)v * ONE) {}
+            constexpr Fixed(double v) : raw((int64_t)(v * ONE + (v < 0 ? -0.5 : 0.5))) {}
+
+            static constexpr Fixed fromRaw(int64_t raw) { return Fixed(raw, 0); }
+            constexpr int64_t getRaw() const { return raw; }
+            explicit constexpr operator double() const { return (double)raw / ONE; }
+
+            friend constexpr Fixed operator+(Fixed a, Fixed b) { return fromRaw(a.raw + b.raw); }
+            friend constexpr Fixed operator-(Fixed a, Fixed b) { return fromRaw(a.raw - b.raw); }
+            friend constexpr Fixed operator-(Fixed a) { return fromRaw(-a.raw); }
+            // arithmetic shift, rounds toward minus infinity
+            friend constexpr Fixed operator*(Fixed a, Fixed b) { return fromRaw((a.raw * b.raw) >> FRAC_BITS); }
+            friend constexpr Fixed operator/(Fixed a, Fixed b) { return fromRaw(a.raw * ONE / b.raw); }
+            Fixed & operator+=(Fixed b) { raw += b.raw; return *this; }
+            Fixed & operator-=(Fixed b) { raw -= b.raw; return *this; }
+            Fixed & operator*=(Fixed b) { return *this = *this * b; }
+            Fixed & operator/=(Fixed b) { return *this = *this / b; }
+
+            friend constexpr bool operator==(Fixed a, Fixed b) { return a.raw == b.raw; }
+            friend constexpr bool operator!=(Fixed a, Fixed b) { return a.raw != b.raw; }
+            friend constexpr bool operator<(Fixed a, Fixed b) { return a.raw < b.raw; }
+            friend constexpr bool operator>(Fixed a, Fixed b) { return a.raw > b.raw; }
+            friend constexpr bool operator<=(Fixed a, Fixed b) { return a.raw <= b.raw; }
+            friend constexpr bool operator>=(Fixed a, Fixed b) { return a.raw >= b.raw; }
+
+        private:
+            constexpr Fixed(int64_t raw, int) : raw(raw) {}
+            int64_t raw;
+    };
+
+    template <typename T>
+    struct BasicVertex {
+        T x;
+        T y;
+        T z;
+    };
+
+    typedef BasicVertex<double> Vertex;
+    typedef BasicVertex<float> VertexF;
+    typedef BasicVertex<Fixed> VertexFixed;
     
+    // 28.4 fixed point vertex, 1/16 pixel precision
+    typedef struct {
+        int32_t x;
+        int32_t y;
+    } FixedVertex;
+
+    const int32_t SUBPIXEL_BITS = 4;
+    const int32_t SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
     typedef struct {
         int32_t x1, y1;
         int32_t x2, y2;
     } SquareDefinition;
 
-    class BaseGeometry {
+    // 2D affine transform: x' = a * x + b * y + tx, y' = c * x + d * y + ty
+    typedef struct {
+        double a, b;
+        double c, d;
+        double tx, ty;
+    } Affine2D;
+
+    // the vertex math over one scalar type, instantiated for float, double and Fixed in base_geometry.cpp
+    template <typename T>
+    class BasicGeometry {
+        public:
+            static T sign (BasicVertex<T> p1, BasicVertex<T> p2, BasicVertex<T> p3);
+            static BasicVertex<T> rotate2D (BasicVertex<T> p, BasicVertex<T> around, double angle);
+            // the same with the trigonometry of the angle computed once for many vertices
+            static BasicVertex<T> rotate2D (BasicVertex<T> p, BasicVertex<T> around, T cos_a, T sin_a);
+            static BasicVertex<T> translate3D (BasicVertex<T> p, T x, T y, T z);
+            static FixedVertex snapToSubpixel (BasicVertex<T> p);
+    };
+
+    extern template class BasicGeometry<float>;
+    extern template class BasicGeometry<double>;
+    extern template class BasicGeometry<Fixed>;
+
+    class BaseGeometry : public BasicGeometry<double> {
         public:
-            static double sign (Vertex p1, Vertex p2, Vertex p3);
-            static Vertex rotate2D (Vertex p, Vertex around, double angle);
-            static Vertex translate3D (Vertex p, int32_t x, int32_t y, int32_t z);
+            static Affine2D translation2D (double dx, double dy);
+            static Affine2D rotation2D (Vertex around, double angle);
+            static Affine2D scaling2D (Vertex around, double sx, double sy);
+            // first applied, then second
+            static Affine2D compose2D (const Affine2D & second, const Affine2D & first);
+            static Vertex apply2D (const Affine2D & m, Vertex p);
     };
 }
 
@@ -0,0 +1,224 @@
+#include <cmath>
+
+#include "matrix.hpp"
+#include "vertex_buffer.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MATRIX_X86
+#include <immintrin.h>
+#endif
+
+namespace szilv {
+
+    typedef void (*Apply3Kernel)(const Mat3 & a, const double * xs, const double * ys,
+            double * out_xs, double * out_ys, uint32_t count);
+    typedef void (*Apply4Kernel)(const Mat4 & a, const double * xs, const double * ys, const double * zs,
+            double * out_xs, double * out_ys, double * out_zs, double * out_ws, uint32_t count);
+
+    /**
+     * the same expressions as the single vertex Matrix::apply
+     */
+    static void apply3Scalar(const Mat3 & a, const double * xs, const double * ys,
+            double * out_xs, double * out_ys, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            double x = xs[i];
+            double y = ys[i];
+            double w = a.m[6] * x + a.m[7] * y + a.m[8];
+            out_xs[i] = (a.m[0] * x + a.m[1] * y + a.m[2]) / w;
+            out_ys[i] = (a.m[3] * x + a.m[4] * y + a.m[5]) / w;
+        }
+    }
+
+    static void apply4Scalar(const Mat4 & a, const double * xs, const double * ys, const double * zs,
+            double * out_xs, double * out_ys, double * out_zs, double * out_ws, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            double x = xs[i];
+            double y = ys[i];
+            double z = zs[i];
+            out_xs[i] = a.m[0] * x + a.m[1] * y + a.m[2] * z + a.m[3];
+            out_ys[i] = a.m[4] * x + a.m[5] * y + a.m[6] * z + a.m[7];
+            out_zs[i] = a.m[8] * x + a.m[9] * y + a.m[10] * z + a.m[11];
+            out_ws[i] = a.m[12] * x + a.m[13] * y + a.m[14] * z + a.m[15];
+        }
+    }
+
+#if defined(MATRIX_X86)
+    /**
+     * one row of the matrix on 4 vertices, multiply and add separately so it matches the scalar result
+     */
+    __attribute__((target("avx")))
+    static inline __m256d row3AVX(const double * r, __m256d x, __m256d y) {
+        __m256d s = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(r[0]), x), _mm256_mul_pd(_mm256_set1_pd(r[1]), y));
+        return _mm256_add_pd(s, _mm256_set1_pd(r[2]));
+    }
+
+    __attribute__((target("avx")))
+    static inline __m256d row4AVX(const double * r, __m256d x, __m256d y, __m256d z) {
+        __m256d s = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(r[0]), x), _mm256_mul_pd(_mm256_set1_pd(r[1]), y));
+        s = _mm256_add_pd(s, _mm256_mul_pd(_mm256_set1_pd(r[2]), z));
+        return _mm256_add_pd(s, _mm256_set1_pd(r[3]));
+    }
+
+    __attribute__((target("avx")))
+    static void apply3AVX(const Mat3 & a, const double * xs, const double * ys,
+            double * out_xs, double * out_ys, uint32_t count) {
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m256d x = _mm256_loadu_pd(xs + i);
+            __m256d y = _mm256_loadu_pd(ys + i);
+            __m256d w = row3AVX(a.m + 6, x, y);
+            _mm256_storeu_pd(out_xs + i, _mm256_div_pd(row3AVX(a.m, x, y), w));
+            _mm256_storeu_pd(out_ys + i, _mm256_div_pd(row3AVX(a.m + 3, x, y), w));
+        }
+        apply3Scalar(a, xs + i, ys + i, out_xs + i, out_ys + i, count - i);
+    }
+
+    __attribute__((target("avx")))
+    static void apply4AVX(const Mat4 & a, const double * xs, const double * ys, const double * zs,
+            double * out_xs, double * out_ys, double * out_zs, double * out_ws, uint32_t count) {
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m256d x = _mm256_loadu_pd(xs + i);
+            __m256d y = _mm256_loadu_pd(ys + i);
+            __m256d z = _mm256_loadu_pd(zs + i);
+            _mm256_storeu_pd(out_xs + i, row4AVX(a.m, x, y, z));
+            _mm256_storeu_pd(out_ys + i, row4AVX(a.m + 4, x, y, z));
+            _mm256_storeu_pd(out_zs + i, row4AVX(a.m + 8, x, y, z));
+            _mm256_storeu_pd(out_ws + i, row4AVX(a.m + 12, x, y, z));
+        }
+        apply4Scalar(a, xs + i, ys + i, zs + i, out_xs + i, out_ys + i, out_zs + i, out_ws + i, count - i);
+    }
+#endif
+
+    Mat3 Matrix::rotation3(double angle) {
+        return rotation3(cos(angle), sin(angle));
+    }
+
+    bool Matrix::invert(const Mat3 & a, Mat3 & out) {
+        double det = determinant(a);
+        if (det == 0) {
+            return false;
+        }
+        double inv = 1 / det;
+        out = {{
+            (a.m[4] * a.m[8] - a.m[5] * a.m[7]) * inv,
+            (a.m[2] * a.m[7] - a.m[1] * a.m[8]) * inv,
+            (a.m[1] * a.m[5] - a.m[2] * a.m[4]) * inv,
+            (a.m[5] * a.m[6] - a.m[3] * a.m[8]) * inv,
+            (a.m[0] * a.m[8] - a.m[2] * a.m[6]) * inv,
+            (a.m[2] * a.m[3] - a.m[0] * a.m[5]) * inv,
+            (a.m[3] * a.m[7] - a.m[4] * a.m[6]) * inv,
+            (a.m[1] * a.m[6] - a.m[0] * a.m[7]) * inv,
+            (a.m[0] * a.m[4] - a.m[1] * a.m[3]) * inv
+        }};
+        return true;
+    }
+
+    void Matrix::apply(const Mat3 & a, const double * xs, const double * ys,
+            double * out_xs, double * out_ys, uint32_t count) {
+#if defined(MATRIX_X86)
+        static const Apply3Kernel kernel = VertexBuffer2D::getPath() == TransformAVX ? apply3AVX : apply3Scalar;
+#else
+        static const Apply3Kernel kernel = apply3Scalar;
+#endif
+        kernel(a, xs, ys, out_xs, out_ys, count);
+    }
+
+    Mat4 Matrix::rotationX(double angle) {
+        return rotationX(cos(angle), sin(angle));
+    }
+
+    Mat4 Matrix::rotationY(double angle) {
+        return rotationY(cos(angle), sin(angle));
+    }
+
+    Mat4 Matrix::rotationZ(double angle) {
+        return rotationZ(cos(angle), sin(angle));
+    }
+
+    Mat4 Matrix::perspective(double fovy, double aspect, double near, double far) {
+        double f = 1 / tan(fovy / 2);
+        return {{ f / aspect, 0, 0, 0,
+                  0, f, 0, 0,
+                  0, 0, -(far + near) / (far - near), -2 * far * near / (far - near),
+                  0, 0, -1, 0 }};
+    }
+
+    /**
+     * the camera at eye, looking at center, rolled so up points up on the screen
+     */
+    Mat4 Matrix::lookAt(Vertex eye, Vertex center, Vertex up) {
+        // forward
+        double fx = center.x - eye.x, fy = center.y - eye.y, fz = center.z - eye.z;
+        double fl = sqrt(fx * fx + fy * fy + fz * fz);
+        fx /= fl; fy /= fl; fz /= fl;
+        // side = forward x up
+        double sx = fy * up.z - fz * up.y, sy = fz * up.x - fx * up.z, sz = fx * up.y - fy * up.x;
+        double sl = sqrt(sx * sx + sy * sy + sz * sz);
+        sx /= sl; sy /= sl; sz /= sl;
+        // the real up = side x forward
+        double ux = sy * fz - sz * fy, uy = sz * fx - sx * fz, uz = sx * fy - sy * fx;
+        return {{  sx,  sy,  sz, -(sx * eye.x + sy * eye.y + sz * eye.z),
+                   ux,  uy,  uz, -(ux * eye.x + uy * eye.y + uz * eye.z),
+                  -fx, -fy, -fz,  (fx * eye.x + fy * eye.y + fz * eye.z),
+                   0,   0,   0,   1 }};
+    }
+
+    /**
+     * cofactor expansion over 2x2 sub-determinants of the top and the bottom two rows
+     */
+    bool Matrix::invert(const Mat4 & a, Mat4 & out) {
+        const double * m = a.m;
+        double s0 = m[0] * m[5] - m[4] * m[1];
+        double s1 = m[0] * m[6] - m[4] * m[2];
+        double s2 = m[0] * m[7] - m[4] * m[3];
+        double s3 = m[1] * m[6] - m[5] * m[2];
+        double s4 = m[1] * m[7] - m[5] * m[3];
+        double s5 = m[2] * m[7] - m[6] * m[3];
+
+        double c5 = m[10] * m[15] - m[14] * m[11];
+        double c4 = m[9] * m[15] - m[13] * m[11];
+        double c3 = m[9] * m[14] - m[13] * m[10];
+        double c2 = m[8] * m[15] - m[12] * m[11];
+        double c1 = m[8] * m[14] - m[12] * m[10];
+        double c0 = m[8] * m[13] - m[12] * m[9];
+
+        double det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        if (det == 0) {
+            return false;
+        }
+        double inv = 1 / det;
+        out = {{
+            ( m[5] * c5 - m[6] * c4 + m[7] * c3) * inv,
+            (-m[1] * c5 + m[2] * c4 - m[3] * c3) * inv,
+            ( m[13] * s5 - m[14] * s4 + m[15] * s3) * inv,
+            (-m[9] * s5 + m[10] * s4 - m[11] * s3) * inv,
+
+            (-m[4] * c5 + m[6] * c2 - m[7] * c1) * inv,
+            ( m[0] * c5 - m[2] * c2 + m[3] * c1) * inv,
+            (-m[12] * s5 + m[14] * s2 - m[15] * s1) * inv,
+            ( m[8] * s5 - m[10] * s2 + m[11] * s1) * inv,
+
+            ( m[4] * c4 - m[5] * c2 + m[7] * c0) * inv,
+            (-m[0] * c4 + m[1] * c2 - m[3] * c0) * inv,
+            ( m[12] * s4 - m[13] * s2 + m[15] * s0) * inv,
+            (-m[8] * s4 + m[9] * s2 - m[11] * s0) * inv,
+
+            (-m[4] * c3 + m[5] * c1 - m[6] * c0) * inv,
+            ( m[0] * c3 - m[1] * c1 + m[2] * c0) * inv,
+            (-m[12] * s3 + m[13] * s1 - m[14] * s0) * inv,
+            ( m[8] * s3 - m[9] * s1 + m[10] * s0) * inv
+        }};
+        return true;
+    }
+
+    void Matrix::apply(const Mat4 & a, const double * xs, const double * ys, const double * zs,
+            double * out_xs, double * out_ys, double * out_zs, double * out_ws, uint32_t count) {
+#if defined(MATRIX_X86)
+        static const Apply4Kernel kernel = VertexBuffer2D::getPath() == TransformAVX ? apply4AVX : apply4Scalar;
+#else
+        static const Apply4Kernel kernel = apply4Scalar;
+#endif
+        kernel(a, xs, ys, zs, out_xs, out_ys, out_zs, out_ws, count);
+    }
+}
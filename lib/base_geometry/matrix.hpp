@@ -0,0 +1,179 @@
+#if !defined(MATRIX_H)
+#define MATRIX_H
+
+#include <cstdint>
+
+#include "base_geometry.hpp"
+
+namespace szilv {
+
+    // Row major, for column vectors: p' = M * p, so multiply(a, b) applies b first then a.
+    // 2D homogeneous transform, the last row is 0 0 1 unless it is a projective one
+    typedef struct {
+        double m[9];
+    } Mat3;
+
+    // 3D homogeneous transform, model, view and projection
+    typedef struct {
+        double m[16];
+    } Mat4;
+
+    // the result of a Mat4 before the perspective divide, clip space
+    typedef struct {
+        double x;
+        double y;
+        double z;
+        double w;
+    } Vertex4;
+
+    // The constexpr ones build and compose matrices at compile time, the rest need the math library
+    // (trigonometry, square root) or a branch on the determinant.
+    // The batch apply functions run on structure of arrays coordinates, in place or out of place, with
+    // the same runtime picked SIMD path as VertexBuffer2D.
+    class Matrix {
+        public:
+            static constexpr Mat3 identity3() {
+                return {{ 1, 0, 0,
+                          0, 1, 0,
+                          0, 0, 1 }};
+            }
+            static constexpr Mat3 translation3(double dx, double dy) {
+                return {{ 1, 0, dx,
+                          0, 1, dy,
+                          0, 0, 1 }};
+            }
+            static constexpr Mat3 scaling3(double sx, double sy) {
+                return {{ sx, 0,  0,
+                          0,  sy, 0,
+                          0,  0,  1 }};
+            }
+            // around the origin, with the trigonometry of the angle computed by the caller
+            static constexpr Mat3 rotation3(double cos_a, double sin_a) {
+                return {{ cos_a, -sin_a, 0,
+                          sin_a,  cos_a, 0,
+                          0,      0,     1 }};
+            }
+            static Mat3 rotation3(double angle);
+            static constexpr Mat3 fromAffine2D(const Affine2D & a) {
+                return {{ a.a, a.b, a.tx,
+                          a.c, a.d, a.ty,
+                          0,   0,   1 }};
+            }
+            static constexpr Mat3 multiply(const Mat3 & a, const Mat3 & b) {
+                return {{ dot3(a, b, 0, 0), dot3(a, b, 0, 1), dot3(a, b, 0, 2),
+                          dot3(a, b, 1, 0), dot3(a, b, 1, 1), dot3(a, b, 1, 2),
+                          dot3(a, b, 2, 0), dot3(a, b, 2, 1), dot3(a, b, 2, 2) }};
+            }
+            static constexpr double determinant(const Mat3 & a) {
+                return a.m[0] * (a.m[4] * a.m[8] - a.m[5] * a.m[7])
+                     - a.m[1] * (a.m[3] * a.m[8] - a.m[5] * a.m[6])
+                     + a.m[2] * (a.m[3] * a.m[7] - a.m[4] * a.m[6]);
+            }
+            // false and out untouched when m is singular
+            static bool invert(const Mat3 & m, Mat3 & out);
+            // with the divide by w when the last row makes it projective
+            static constexpr Vertex apply(const Mat3 & a, Vertex p) {
+                return {
+                    (a.m[0] * p.x + a.m[1] * p.y + a.m[2]) / (a.m[6] * p.x + a.m[7] * p.y + a.m[8]),
+                    (a.m[3] * p.x + a.m[4] * p.y + a.m[5]) / (a.m[6] * p.x + a.m[7] * p.y + a.m[8]),
+                    p.z
+                };
+            }
+            // count vertices, out_xs and out_ys may be the same arrays as xs and ys
+            static void apply(const Mat3 & a, const double * xs, const double * ys,
+                    double * out_xs, double * out_ys, uint32_t count);
+
+            static constexpr Mat4 identity4() {
+                return {{ 1, 0, 0, 0,
+                          0, 1, 0, 0,
+                          0, 0, 1, 0,
+                          0, 0, 0, 1 }};
+            }
+            static constexpr Mat4 translation4(double dx, double dy, double dz) {
+                return {{ 1, 0, 0, dx,
+                          0, 1, 0, dy,
+                          0, 0, 1, dz,
+                          0, 0, 0, 1 }};
+            }
+            static constexpr Mat4 scaling4(double sx, double sy, double sz) {
+                return {{ sx, 0,  0,  0,
+                          0,  sy, 0,  0,
+                          0,  0,  sz, 0,
+                          0,  0,  0,  1 }};
+            }
+            static constexpr Mat4 rotationX(double cos_a, double sin_a) {
+                return {{ 1, 0,      0,     0,
+                          0, cos_a, -sin_a, 0,
+                          0, sin_a,  cos_a, 0,
+                          0, 0,      0,     1 }};
+            }
+            static constexpr Mat4 rotationY(double cos_a, double sin_a) {
+                return {{  cos_a, 0, sin_a, 0,
+                           0,     1, 0,     0,
+                          -sin_a, 0, cos_a, 0,
+                           0,     0, 0,     1 }};
+            }
+            static constexpr Mat4 rotationZ(double cos_a, double sin_a) {
+                return {{ cos_a, -sin_a, 0, 0,
+                          sin_a,  cos_a, 0, 0,
+                          0,      0,     1, 0,
+                          0,      0,     0, 1 }};
+            }
+            static Mat4 rotationX(double angle);
+            static Mat4 rotationY(double angle);
+            static Mat4 rotationZ(double angle);
+            // OpenGL conventions like linmath.h: the camera looks down -z and the visible depth maps to
+            // -1..1 in normalized device coordinates
+            static constexpr Mat4 frustum(double left, double right, double bottom, double top, double near, double far) {
+                return {{ 2 * near / (right - left), 0, (right + left) / (right - left), 0,
+                          0, 2 * near / (top - bottom), (top + bottom) / (top - bottom), 0,
+                          0, 0, -(far + near) / (far - near), -2 * far * near / (far - near),
+                          0, 0, -1, 0 }};
+            }
+            static constexpr Mat4 ortho(double left, double right, double bottom, double top, double near, double far) {
+                return {{ 2 / (right - left), 0, 0, -(right + left) / (right - left),
+                          0, 2 / (top - bottom), 0, -(top + bottom) / (top - bottom),
+                          0, 0, -2 / (far - near), -(far + near) / (far - near),
+                          0, 0, 0, 1 }};
+            }
+            // fovy in radians
+            static Mat4 perspective(double fovy, double aspect, double near, double far);
+            static Mat4 lookAt(Vertex eye, Vertex center, Vertex up);
+            static constexpr Mat4 multiply(const Mat4 & a, const Mat4 & b) {
+                return {{ dot4(a, b, 0, 0), dot4(a, b, 0, 1), dot4(a, b, 0, 2), dot4(a, b, 0, 3),
+                          dot4(a, b, 1, 0), dot4(a, b, 1, 1), dot4(a, b, 1, 2), dot4(a, b, 1, 3),
+                          dot4(a, b, 2, 0), dot4(a, b, 2, 1), dot4(a, b, 2, 2), dot4(a, b, 2, 3),
+                          dot4(a, b, 3, 0), dot4(a, b, 3, 1), dot4(a, b, 3, 2), dot4(a, b, 3, 3) }};
+            }
+            static constexpr Mat4 transpose(const Mat4 & a) {
+                return {{ a.m[0], a.m[4], a.m[8],  a.m[12],
+                          a.m[1], a.m[5], a.m[9],  a.m[13],
+                          a.m[2], a.m[6], a.m[10], a.m[14],
+                          a.m[3], a.m[7], a.m[11], a.m[15] }};
+            }
+            // false and out untouched when m is singular
+            static bool invert(const Mat4 & m, Mat4 & out);
+            static constexpr Vertex4 apply(const Mat4 & a, Vertex p) {
+                return {
+                    a.m[0] * p.x + a.m[1] * p.y + a.m[2] * p.z + a.m[3],
+                    a.m[4] * p.x + a.m[5] * p.y + a.m[6] * p.z + a.m[7],
+                    a.m[8] * p.x + a.m[9] * p.y + a.m[10] * p.z + a.m[11],
+                    a.m[12] * p.x + a.m[13] * p.y + a.m[14] * p.z + a.m[15]
+                };
+            }
+            // count vertices to clip space, w is not divided out
+            static void apply(const Mat4 & a, const double * xs, const double * ys, const double * zs,
+                    double * out_xs, double * out_ys, double * out_zs, double * out_ws, uint32_t count);
+
+        private:
+            static constexpr double dot3(const Mat3 & a, const Mat3 & b, int r, int c) {
+                return a.m[r * 3] * b.m[c] + a.m[r * 3 + 1] * b.m[3 + c] + a.m[r * 3 + 2] * b.m[6 + c];
+            }
+            static constexpr double dot4(const Mat4 & a, const Mat4 & b, int r, int c) {
+                return a.m[r * 4] * b.m[c] + a.m[r * 4 + 1] * b.m[4 + c]
+                     + a.m[r * 4 + 2] * b.m[8 + c] + a.m[r * 4 + 3] * b.m[12 + c];
+            }
+    };
+}
+
+#endif /* !defined(MATRIX_H) */
@@ -0,0 +1,143 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+
+#include "base_geometry.hpp"
+#include "matrix.hpp"
+
+/**
+ * Checks the Matrix functions the 3D pipeline builds its transforms from: invert(M) * M is the identity
+ * for Mat3 and Mat4 (affine and projective ones), a singular matrix is refused, frustum and perspective
+ * agree, and perspective, lookAt and their product map known points to the expected normalized device
+ * coordinates. Exits with 1 when any check fails.
+ *
+ * usage: matrix_test
+ */
+
+static const double eps = 1e-9;
+static bool ok = true;
+
+static void expect(const char * name, double value, double expected) {
+    if (std::fabs(value - expected) > eps) {
+        std::cerr << name << " is " << value << ", expected " << expected << std::endl;
+        ok = false;
+    }
+}
+
+static void expectIdentity(const char * name, const szilv::Mat3 & a) {
+    szilv::Mat3 id = szilv::Matrix::identity3();
+    for (int i = 0; i < 9; i++) {
+        expect(name, a.m[i], id.m[i]);
+    }
+}
+
+static void expectIdentity(const char * name, const szilv::Mat4 & a) {
+    szilv::Mat4 id = szilv::Matrix::identity4();
+    for (int i = 0; i < 16; i++) {
+        expect(name, a.m[i], id.m[i]);
+    }
+}
+
+// the point after the perspective divide
+static void expectNdc(const char * name, const szilv::Mat4 & a, szilv::Vertex p, double x, double y, double z) {
+    szilv::Vertex4 c = szilv::Matrix::apply(a, p);
+    expect(name, c.x / c.w, x);
+    expect(name, c.y / c.w, y);
+    expect(name, c.z / c.w, z);
+}
+
+static void checkInvert3() {
+    using szilv::Matrix;
+    using szilv::Mat3;
+    Mat3 affine = Matrix::multiply(Matrix::translation3(3, -2),
+            Matrix::multiply(Matrix::rotation3(0.7), Matrix::scaling3(2, 0.5)));
+    Mat3 projective = {{ 1, 0.2, 3,
+                         0.1, 2, -1,
+                         0.01, 0.02, 1 }};
+    for (const Mat3 & m : { affine, projective }) {
+        Mat3 inv;
+        if (!Matrix::invert(m, inv)) {
+            std::cerr << "Mat3 invert refused an invertible matrix" << std::endl;
+            ok = false;
+            continue;
+        }
+        expectIdentity("Mat3 invert(M) * M", Matrix::multiply(inv, m));
+        expectIdentity("Mat3 M * invert(M)", Matrix::multiply(m, inv));
+    }
+    Mat3 untouched = Matrix::translation3(1, 2);
+    if (Matrix::invert(Matrix::scaling3(0, 1), untouched) || untouched.m[2] != 1 || untouched.m[5] != 2) {
+        std::cerr << "Mat3 invert accepted a singular matrix or changed out" << std::endl;
+        ok = false;
+    }
+}
+
+static void checkInvert4() {
+    using szilv::Matrix;
+    using szilv::Mat4;
+    Mat4 model = Matrix::multiply(Matrix::translation4(1, -2, 3),
+            Matrix::multiply(Matrix::rotationY(0.4), Matrix::multiply(Matrix::rotationX(-1.1),
+            Matrix::scaling4(2, 0.5, 3))));
+    Mat4 view = Matrix::lookAt({ 4, 3, 5 }, { 0, 0, 0 }, { 0, 1, 0 });
+    Mat4 projection = Matrix::perspective(M_PI / 3, 16.0 / 9, 0.1, 100);
+    for (const Mat4 & m : { model, view, projection, Matrix::multiply(projection, Matrix::multiply(view, model)) }) {
+        Mat4 inv;
+        if (!Matrix::invert(m, inv)) {
+            std::cerr << "Mat4 invert refused an invertible matrix" << std::endl;
+            ok = false;
+            continue;
+        }
+        expectIdentity("Mat4 invert(M) * M", Matrix::multiply(inv, m));
+        expectIdentity("Mat4 M * invert(M)", Matrix::multiply(m, inv));
+    }
+    Mat4 untouched = Matrix::translation4(1, 2, 3);
+    if (Matrix::invert(Matrix::scaling4(1, 0, 1), untouched) || untouched.m[3] != 1 || untouched.m[7] != 2) {
+        std::cerr << "Mat4 invert accepted a singular matrix or changed out" << std::endl;
+        ok = false;
+    }
+}
+
+static void checkProjection() {
+    using szilv::Matrix;
+    using szilv::Mat4;
+    // 90 degrees vertically, twice as wide: at the distance d the visible square is [-2d, 2d] x [-d, d]
+    const double near = 1, far = 10;
+    Mat4 projection = Matrix::perspective(M_PI / 2, 2, near, far);
+    expectNdc("perspective near center", projection, { 0, 0, -near }, 0, 0, -1);
+    expectNdc("perspective far center", projection, { 0, 0, -far }, 0, 0, 1);
+    expectNdc("perspective near corner", projection, { 2, 1, -near }, 1, 1, -1);
+    expectNdc("perspective far corner", projection, { -2 * far, -far, -far }, -1, -1, 1);
+    // the depth is not linear: (far + near) / (far - near) - 2 * far * near / ((far - near) * d)
+    expectNdc("perspective depth", projection, { 0, 0, -5 }, 0, 0, 7.0 / 9);
+
+    Mat4 frustum = Matrix::frustum(-2, 2, -1, 1, near, far);
+    for (int i = 0; i < 16; i++) {
+        expect("frustum against perspective", frustum.m[i], projection.m[i]);
+    }
+
+    // the camera on +x looking at the origin: -z of the world is to its right, +y stays up
+    Mat4 view = Matrix::lookAt({ 5, 0, 0 }, { 0, 0, 0 }, { 0, 1, 0 });
+    szilv::Vertex4 v = Matrix::apply(view, { 0, 0, 0 });
+    expect("lookAt center x", v.x, 0);
+    expect("lookAt center y", v.y, 0);
+    expect("lookAt center z", v.z, -5);
+    expect("lookAt center w", v.w, 1);
+    v = Matrix::apply(view, { 0, 2, -3 });
+    expect("lookAt right x", v.x, 3);
+    expect("lookAt up y", v.y, 2);
+    expect("lookAt right z", v.z, -5);
+    v = Matrix::apply(view, { 5, 0, 0 });
+    expect("lookAt eye z", v.z, 0);
+
+    Mat4 view_projection = Matrix::multiply(projection, view);
+    expectNdc("view projection center", view_projection, { 0, 0, 0 }, 0, 0, 7.0 / 9);
+    expectNdc("view projection corner", view_projection, { 0, 5, -10 }, 1, 1, 7.0 / 9);
+}
+
+int main() {
+    checkInvert3();
+    checkInvert4();
+    checkProjection();
+    std::cout << (ok ? "matrices match" : "matrices differ") << std::endl;
+    return ok ? 0 : 1;
+}
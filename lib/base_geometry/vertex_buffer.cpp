@@ -0,0 +1,189 @@
+#include "vertex_buffer.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VERTEX_BUFFER_X86
+#include <immintrin.h>
+#endif
+
+namespace szilv {
+
+    template <typename T>
+    using TransformKernel = void (*)(const Affine2D & m, T * xs, T * ys, uint32_t count);
+
+    /**
+     * the same expression as BaseGeometry::apply2D, with the matrix in T
+     */
+    template <typename T>
+    static void transformScalar(const Affine2D & m, T * xs, T * ys, uint32_t count) {
+        const T a = T(m.a), b = T(m.b), c = T(m.c), d = T(m.d), tx = T(m.tx), ty = T(m.ty);
+        for (uint32_t i = 0; i < count; i++) {
+            T x = xs[i];
+            T y = ys[i];
+            xs[i] = a * x + b * y + tx;
+            ys[i] = c * x + d * y + ty;
+        }
+    }
+
+#if defined(VERTEX_BUFFER_X86)
+    /**
+     * 4 vertices per iteration. Multiply and add separately, no FMA: the results are the same as the
+     * scalar ones to the last bit
+     */
+    __attribute__((target("avx")))
+    static void transformAVX(const Affine2D & m, double * xs, double * ys, uint32_t count) {
+        const __m256d a = _mm256_set1_pd(m.a);
+        const __m256d b = _mm256_set1_pd(m.b);
+        const __m256d c = _mm256_set1_pd(m.c);
+        const __m256d d = _mm256_set1_pd(m.d);
+        const __m256d tx = _mm256_set1_pd(m.tx);
+        const __m256d ty = _mm256_set1_pd(m.ty);
+        uint32_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m256d x = _mm256_loadu_pd(xs + i);
+            __m256d y = _mm256_loadu_pd(ys + i);
+            __m256d nx = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a, x), _mm256_mul_pd(b, y)), tx);
+            __m256d ny = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(c, x), _mm256_mul_pd(d, y)), ty);
+            _mm256_storeu_pd(xs + i, nx);
+            _mm256_storeu_pd(ys + i, ny);
+        }
+        transformScalar(m, xs + i, ys + i, count - i);
+    }
+
+    /**
+     * the float one, 8 vertices per iteration
+     */
+    __attribute__((target("avx")))
+    static void transformAVX(const Affine2D & m, float * xs, float * ys, uint32_t count) {
+        const __m256 a = _mm256_set1_ps((float)m.a);
+        const __m256 b = _mm256_set1_ps((float)m.b);
+        const __m256 c = _mm256_set1_ps((float)m.c);
+        const __m256 d = _mm256_set1_ps((float)m.d);
+        const __m256 tx = _mm256_set1_ps((float)m.tx);
+        const __m256 ty = _mm256_set1_ps((float)m.ty);
+        uint32_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 x = _mm256_loadu_ps(xs + i);
+            __m256 y = _mm256_loadu_ps(ys + i);
+            __m256 nx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, x), _mm256_mul_ps(b, y)), tx);
+            __m256 ny = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c, x), _mm256_mul_ps(d, y)), ty);
+            _mm256_storeu_ps(xs + i, nx);
+            _mm256_storeu_ps(ys + i, ny);
+        }
+        transformScalar(m, xs + i, ys + i, count - i);
+    }
+#endif
+
+    static TransformPath detectPath() {
+#if defined(VERTEX_BUFFER_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx")) {
+            return TransformAVX;
+        }
+#endif
+        return TransformScalar;
+    }
+
+    template <typename T>
+    static TransformKernel<T> selectKernel() {
+        return transformScalar<T>;
+    }
+
+#if defined(VERTEX_BUFFER_X86)
+    template <>
+    TransformKernel<double> selectKernel<double>() {
+        if (detectPath() == TransformAVX) {
+            return transformAVX;
+        }
+        return transformScalar<double>;
+    }
+
+    template <>
+    TransformKernel<float> selectKernel<float>() {
+        if (detectPath() == TransformAVX) {
+            return transformAVX;
+        }
+        return transformScalar<float>;
+    }
+#endif
+
+    /**
+     * the path of the T kernel, Fixed is always scalar
+     */
+    template <typename T>
+    TransformPath BasicVertexBuffer2D<T>::getPath() {
+        static const TransformPath path = selectKernel<T>() == transformScalar<T> ? TransformScalar : TransformAVX;
+        return path;
+    }
+
+    template <typename T>
+    const char * BasicVertexBuffer2D<T>::getPathName() {
+        return getPath() == TransformAVX ? "avx" : "scalar";
+    }
+
+    template <typename T>
+    BasicVertexBuffer2D<T>::BasicVertexBuffer2D(uint32_t size) : xs(size), ys(size) {}
+
+    template <typename T>
+    void BasicVertexBuffer2D<T>::resize(uint32_t size) {
+        xs.resize(size);
+        ys.resize(size);
+    }
+
+    template <typename T>
+    void BasicVertexBuffer2D<T>::push_back(BasicVertex<T> v) {
+        xs.push_back(v.x);
+        ys.push_back(v.y);
+    }
+
+    template <typename T>
+    void BasicVertexBuffer2D<T>::transform(const Affine2D & m, uint32_t first, uint32_t count) {
+        static const TransformKernel<T> kernel = selectKernel<T>();
+        if (first >= size()) {
+            return;
+        }
+        if (count > size() - first) {
+            count = size() - first;
+        }
+        kernel(m, xs.data() + first, ys.data() + first, count);
+    }
+
+    /**
+     * the same expressions as the single vertex Matrix::apply
+     */
+    template <typename T>
+    static void applyMat3(const Mat3 & m, T * xs, T * ys, uint32_t count) {
+        T a[9];
+        for (int i = 0; i < 9; i++) {
+            a[i] = T(m.m[i]);
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            T x = xs[i];
+            T y = ys[i];
+            T w = a[6] * x + a[7] * y + a[8];
+            xs[i] = (a[0] * x + a[1] * y + a[2]) / w;
+            ys[i] = (a[3] * x + a[4] * y + a[5]) / w;
+        }
+    }
+
+    /**
+     * the double one goes through the SIMD batch apply of Matrix
+     */
+    static void applyMat3(const Mat3 & m, double * xs, double * ys, uint32_t count) {
+        Matrix::apply(m, xs, ys, xs, ys, count);
+    }
+
+    template <typename T>
+    void BasicVertexBuffer2D<T>::transform(const Mat3 & m, uint32_t first, uint32_t count) {
+        if (first >= size()) {
+            return;
+        }
+        if (count > size() - first) {
+            count = size() - first;
+        }
+        applyMat3(m, xs.data() + first, ys.data() + first, count);
+    }
+
+    template class BasicVertexBuffer2D<float>;
+    template class BasicVertexBuffer2D<double>;
+    template class BasicVertexBuffer2D<Fixed>;
+}
@@ -0,0 +1,62 @@
+#if !defined(VERTEX_BUFFER_2D_H)
+#define VERTEX_BUFFER_2D_H
+
+#include <cstdint>
+#include <vector>
+
+#include "base_geometry.hpp"
+#include "matrix.hpp"
+
+namespace szilv {
+
+    enum TransformPath {
+        TransformScalar,
+        TransformAVX
+    };
+
+    // Structure of arrays 2D vertices: the x and the y coordinates in two arrays, so a batch transform
+    // runs over them four (double) or eight (float) at a time. The transforms build their matrix once (one
+    // cos and sin for a rotation) and apply it to the whole range. Disjoint ranges can be transformed from
+    // different threads at the same time, e.g. one chunk per pool task.
+    // Instantiated for float, double and Fixed in vertex_buffer.cpp, Fixed only has the scalar kernel.
+    template <typename T>
+    class BasicVertexBuffer2D {
+        public:
+            BasicVertexBuffer2D(uint32_t size = 0);
+
+            uint32_t size() const { return xs.size(); }
+            void resize(uint32_t size);
+            void push_back(BasicVertex<T> v);
+            BasicVertex<T> get(uint32_t i) const { return { xs[i], ys[i], T(0) }; }
+            void set(uint32_t i, BasicVertex<T> v) { xs[i] = v.x; ys[i] = v.y; }
+            T * getX() { return xs.data(); }
+            T * getY() { return ys.data(); }
+
+            // [first, first + count), the matrix is rounded to T once
+            virtual void transform(const Affine2D & m, uint32_t first, uint32_t count);
+            void transform(const Affine2D & m) { transform(m, 0, size()); }
+            // projective ones divide by w
+            void transform(const Mat3 & m, uint32_t first, uint32_t count);
+            void transform(const Mat3 & m) { transform(m, 0, size()); }
+            void translate(double dx, double dy) { transform(BaseGeometry::translation2D(dx, dy)); }
+            void rotate(Vertex around, double angle) { transform(BaseGeometry::rotation2D(around, angle)); }
+            void scale(Vertex around, double sx, double sy) { transform(BaseGeometry::scaling2D(around, sx, sy)); }
+
+            static TransformPath getPath();
+            static const char * getPathName();
+
+        private:
+            std::vector<T> xs;
+            std::vector<T> ys;
+    };
+
+    extern template class BasicVertexBuffer2D<float>;
+    extern template class BasicVertexBuffer2D<double>;
+    extern template class BasicVertexBuffer2D<Fixed>;
+
+    typedef BasicVertexBuffer2D<double> VertexBuffer2D;
+    typedef BasicVertexBuffer2D<float> VertexBuffer2DF;
+    typedef BasicVertexBuffer2D<Fixed> VertexBuffer2DFixed;
+}
+
+#endif /* !defined(VERTEX_BUFFER_2D_H) */
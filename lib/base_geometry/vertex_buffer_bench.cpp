@@ -0,0 +1,89 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#include "base_geometry.hpp"
+#include "vertex_buffer.hpp"
+
+/**
+ * Rotating many vertices around a point: BaseGeometry::rotate2D per vertex (an array of Vertex structs,
+ * a cos and a sin per vertex) against one rotation matrix applied to a VertexBuffer2D, single threaded
+ * and in one chunk per thread.
+ *
+ * usage: vertex_buffer_bench [vertices] [iterations] [threads]
+ */
+
+template <typename F>
+static double measure(uint32_t iterations, uint64_t vertices, F f) {
+    f(); // warm up
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        f();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / ((double)iterations * vertices);
+}
+
+int main(int argc, char **argv) {
+    uint32_t nr_of_vertices = argc > 1 ? std::atoi(argv[1]) : 300000;
+    uint32_t iterations = argc > 2 ? std::atoi(argv[2]) : 100;
+    uint32_t nr_of_threads = argc > 3 ? std::atoi(argv[3]) : std::max(1U, std::thread::hardware_concurrency());
+    const szilv::Vertex around = { 960, 540, 0 };
+    const double angle = 0.001;
+
+    std::vector<szilv::Vertex> aos(nr_of_vertices);
+    szilv::VertexBuffer2D soa(nr_of_vertices);
+    szilv::VertexBuffer2D soa_threads(nr_of_vertices);
+    for (uint32_t i = 0; i < nr_of_vertices; i++) {
+        aos[i] = { (double)(i % 1920), (double)(i / 1920 % 1080), 0 };
+        soa.set(i, aos[i]);
+        soa_threads.set(i, aos[i]);
+    }
+
+    double per_vertex = measure(iterations, nr_of_vertices, [&]() {
+        for (auto & v : aos) {
+            v = szilv::BaseGeometry::rotate2D(v, around, angle);
+        }
+    });
+    double batch = measure(iterations, nr_of_vertices, [&]() {
+        soa.rotate(around, angle);
+    });
+    double chunks = measure(iterations, nr_of_vertices, [&]() {
+        szilv::Affine2D m = szilv::BaseGeometry::rotation2D(around, angle);
+        uint32_t chunk = (nr_of_vertices + nr_of_threads - 1) / nr_of_threads;
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < nr_of_threads; t++) {
+            threads.push_back(std::thread([&soa_threads, &m, t, chunk]() {
+                soa_threads.transform(m, t * chunk, chunk);
+            }));
+        }
+        for (auto & thd : threads) {
+            thd.join();
+        }
+    });
+
+    // the matrix rounds differently than rotate2D, but not more than a rounding error per step
+    double max_diff = 0;
+    bool same_chunks = true;
+    for (uint32_t i = 0; i < nr_of_vertices; i++) {
+        szilv::Vertex v = soa.get(i);
+        max_diff = std::max({max_diff, std::fabs(v.x - aos[i].x), std::fabs(v.y - aos[i].y)});
+        szilv::Vertex w = soa_threads.get(i);
+        same_chunks = same_chunks && v.x == w.x && v.y == w.y;
+    }
+
+    std::cout << nr_of_vertices << " vertices, " << iterations << " iterations, ns/vertex, "
+        << szilv::VertexBuffer2D::getPathName() << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  rotate2D per vertex  " << per_vertex << std::endl;
+    std::cout << "  VertexBuffer2D       " << batch << "  (" << per_vertex / batch << "x)" << std::endl;
+    std::cout << "  " << std::setw(2) << nr_of_threads << " chunks            " << chunks << "  (" << per_vertex / chunks << "x)" << std::endl;
+    std::cout << "  max difference " << std::scientific << max_diff << (same_chunks ? ", chunks identical" : ", chunks DIFFER") << std::endl;
+
+    return same_chunks && max_diff < 1e-6 ? 0 : 1;
+}
@@ -9,14 +9,27 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <poll.h>
 #include <cerrno>
 #include <iostream>
 #include <cstring>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cmath>
 
 namespace szilv {
-    DrmUtil::DrmUtil(const char * card) {
+    DrmUtil::DrmUtil(const char * card, bool page_flip, uint32_t nr_of_bufs, bool atomic, bool all_outputs) {
         this->_card = card;
-        std::clog << "using card " << card << std::endl;
+        this->mdev = nullptr;
+        this->atomic = atomic;
+        this->all_outputs = all_outputs;
+        this->page_flip = page_flip || atomic;
+        this->nr_of_bufs = std::min(MODESET_MAX_BUFFERS, std::max(MODESET_MIN_BUFFERS, nr_of_bufs));
+        std::clog << "using card " << card << " with " << this->nr_of_bufs << " buffers"
+            << (atomic ? " and atomic flips" : this->page_flip ? " and page flips" : "")
+            << (all_outputs ? " on all outputs" : "") << std::endl;
     }
 
     /**
@@ -51,25 +64,31 @@ namespace szilv {
         modeset_dev *iter;
         struct drm_mode_destroy_dumb dreq;
 
+        /* the flipped buffer must not be destroyed while the flip is still queued */
+        waitForFlip();
+
         while (modeset_list) {
             /* remove from global list */
             iter = modeset_list;
             modeset_list = iter->next;
 
-            /* restore saved CRTC configuration */
-            drmModeSetCrtc(fd,
-                    iter->saved_crtc->crtc_id,
-                    iter->saved_crtc->buffer_id,
-                    iter->saved_crtc->x,
-                    iter->saved_crtc->y,
-                    &iter->conn,
-                    1,
-                    &iter->saved_crtc->mode);
-            drmModeFreeCrtc(iter->saved_crtc);
+            /* restore saved CRTC configuration, only the outputs initDrmDev got to have one */
+            if (iter->saved_crtc) {
+                drmModeSetCrtc(fd,
+                        iter->saved_crtc->crtc_id,
+                        iter->saved_crtc->buffer_id,
+                        iter->saved_crtc->x,
+                        iter->saved_crtc->y,
+                        &iter->conn,
+                        1,
+                        &iter->saved_crtc->mode);
+                drmModeFreeCrtc(iter->saved_crtc);
+            }
 
             /* destroy framebuffers */
-            modeset_destroy_fb(fd, &iter->bufs[1]);
-            modeset_destroy_fb(fd, &iter->bufs[0]);
+            for (int32_t i = iter->nr_of_bufs - 1; i >= 0; i--) {
+                modeset_destroy_fb(fd, &iter->bufs[i]);
+            }
 
             /* free allocated memory */
             free(iter);
@@ -239,12 +258,13 @@ err_destroy:
             return -EFAULT;
         }
 
-        /* copy the mode information into our device structure */
-        memcpy(&dev->mode, &conn->modes[0], sizeof(dev->mode));
-        dev->bufs[0].width = conn->modes[0].hdisplay;
-        dev->bufs[0].height = conn->modes[0].vdisplay;
-        dev->bufs[1].width = conn->modes[0].hdisplay;
-        dev->bufs[1].height = conn->modes[0].vdisplay;
+        /* copy the requested mode into our device structure */
+        int32_t mode_idx = selectMode(conn->modes, conn->count_modes, &requested_mode);
+        memcpy(&dev->mode, &conn->modes[mode_idx], sizeof(dev->mode));
+        for (uint32_t i = 0; i < dev->nr_of_bufs; i++) {
+            dev->bufs[i].width = conn->modes[mode_idx].hdisplay;
+            dev->bufs[i].height = conn->modes[mode_idx].vdisplay;
+        }
         std::clog << "mode for connector " << conn->connector_id << " is " << dev->bufs[0].width 
             << "*" << dev->bufs[0].height << std::endl;
         std::clog << "connector flag: " << dev->mode.flags << std::endl;
@@ -256,19 +276,16 @@ err_destroy:
             return ret;
         }
 
-        /* create a framebuffer #1 for this CRTC */
-        ret = modeset_create_fb(fd, &dev->bufs[0]);
-        if (ret) {
-            std::clog << "cannot create framebuffer for connector " << conn->connector_id << std::endl;
-            return ret;
-        }
-
-        /* create a framebuffer #2 for this CRTC */
-        ret = modeset_create_fb(fd, &dev->bufs[1]);
-        if (ret) {
-            std::clog << "cannot create framebuffer for connector " << conn->connector_id << std::endl;
-            modeset_destroy_fb(fd, &dev->bufs[0]);
-            return ret;
+        /* create a framebuffer for every buffer of the swapchain */
+        for (uint32_t i = 0; i < dev->nr_of_bufs; i++) {
+            ret = modeset_create_fb(fd, &dev->bufs[i]);
+            if (ret) {
+                std::clog << "cannot create framebuffer #" << i + 1 << " for connector " << conn->connector_id << std::endl;
+                while (i--) {
+                    modeset_destroy_fb(fd, &dev->bufs[i]);
+                }
+                return ret;
+            }
         }
 
         return 0;
@@ -323,6 +340,10 @@ err_destroy:
             dev = (modeset_dev *) malloc(sizeof(*dev));
             memset(dev, 0, sizeof(*dev));
             dev->conn = conn->connector_id;
+            dev->nr_of_bufs = nr_of_bufs;
+            dev->flip_buf = -1;
+            dev->queued_buf = -1;
+            dev->drm = this;
 
             /* call helper function to prepare this connector */
             ret = modeset_setup_dev(fd, res, conn, dev);
@@ -350,13 +371,484 @@ err_destroy:
 
     
     void DrmUtil::swap_buffers() {
-        modeset_buf * buf = &mdev->bufs[mdev->front_buf ^ 1];
-        int32_t ret = drmModeSetCrtc(fd, mdev->crtc, buf->fb, 0, 0,
-					     &mdev->conn, 1, &mdev->mode);
+        /* the buffer of the previous swap has to reach the screen first */
+        waitForFlip(mdev);
+        int32_t idx = mdev->front_buf ^ 1;
+        mdev->buf_state[idx] = BUF_DRAWING;
+        present(&mdev->bufs[idx]);
+    }
+
+    /**
+     * The output whose swapchain buf is part of
+     */
+    modeset_dev * DrmUtil::outputOf(modeset_buf * buf) {
+        for (auto dev : outputs) {
+            if (buf >= dev->bufs && buf < dev->bufs + dev->nr_of_bufs) {
+                return dev;
+            }
+        }
+        std::clog << "buffer " << buf << " is not part of a swapchain" << std::endl;
+        return nullptr;
+    }
+
+    modeset_buf * DrmUtil::acquire(bool block) {
+        return acquire(mdev, block);
+    }
+
+    /**
+     * The flip events that arrived meanwhile are dispatched first. With 3 or more buffers a free one
+     * exists right after the first flip, so without that nothing would read the events: the flip
+     * would never complete and every present would just replace the queued frame
+     */
+    modeset_buf * DrmUtil::acquire(modeset_dev * dev, bool block) {
+        if (page_flip) {
+            auto flip_pending = [](const modeset_dev * d) { return d->flip_buf >= 0; };
+            while (std::any_of(outputs.begin(), outputs.end(), flip_pending) && !handleEvents(0)) {
+            }
+        }
+        while (true) {
+            for (uint32_t i = 0; i < dev->nr_of_bufs; i++) {
+                if (dev->buf_state[i] == BUF_FREE) {
+                    dev->buf_state[i] = BUF_DRAWING;
+                    return &dev->bufs[i];
+                }
+            }
+            if (!block) {
+                return nullptr;
+            }
+            if (dev->flip_buf < 0) {
+                /* nothing on the way to the screen, no buffer will get free */
+                std::clog << "all the " << dev->nr_of_bufs << " buffers are acquired" << std::endl;
+                return nullptr;
+            }
+            /* the events of the other outputs are handled meanwhile too */
+            if (handleEvents(-1)) {
+                return nullptr;
+            }
+        }
+    }
+
+    /**
+     *
+     */
+    void DrmUtil::present(modeset_buf * buf, const drm_mode_rect * damage) {
+        modeset_dev * dev = outputOf(buf);
+        int32_t idx = dev ? buf - dev->bufs : -1;
+        if (idx < 0 || dev->buf_state[idx] != BUF_DRAWING) {
+            std::clog << "present of a buffer that was not acquired" << std::endl;
+            return;
+        }
+        dev->has_damage[idx] = damage != nullptr;
+        if (damage) {
+            dev->damage[idx] = *damage;
+        }
+
+        if (page_flip) {
+            int32_t queued_buf = dev->queued_buf;
+            if (queued_buf >= 0) {
+                /* a newer frame is ready before the older one got to the screen, the older one is dropped */
+                dev->buf_state[queued_buf] = BUF_FREE;
+                dev->dropped_frames++;
+                /* what changed in the dropped frame did not reach the screen either */
+                if (dev->has_damage[idx] && dev->has_damage[queued_buf]) {
+                    drm_mode_rect & d = dev->damage[idx];
+                    const drm_mode_rect & q = dev->damage[queued_buf];
+                    d = { std::min(d.x1, q.x1), std::min(d.y1, q.y1), std::max(d.x2, q.x2), std::max(d.y2, q.y2) };
+                } else {
+                    dev->has_damage[idx] = false;
+                }
+            }
+            dev->buf_state[idx] = BUF_QUEUED;
+            dev->queued_buf = idx;
+            /* only one flip can be submitted per CRTC, the rest waits for page_flip_handler */
+            if (dev->flip_buf < 0) {
+                submitQueued(dev);
+            }
+            return;
+        }
+
+        int32_t ret = drmModeSetCrtc(fd, dev->crtc, buf->fb, 0, 0,
+					     &dev->conn, 1, &dev->mode);
         if (ret) {
-            std::clog << "cannot flip CRTC for connector " << mdev->conn << " (" << errno << ")" << std::endl;
+            std::clog << "cannot flip CRTC for connector " << dev->conn << " (" << errno << ")" << std::endl;
+            dev->buf_state[idx] = BUF_FREE;
         } else {
-            mdev->front_buf ^= 1;
+            dev->buf_state[dev->front_buf] = BUF_FREE;
+            dev->buf_state[idx] = BUF_SCANOUT;
+            dev->front_buf = idx;
+        }
+    }
+
+    void DrmUtil::release(modeset_buf * buf) {
+        modeset_dev * dev = outputOf(buf);
+        if (dev && dev->buf_state[buf - dev->bufs] == BUF_DRAWING) {
+            dev->buf_state[buf - dev->bufs] = BUF_FREE;
+        }
+    }
+
+    uint32_t DrmUtil::getDroppedFrames() {
+        uint32_t dropped_frames = 0;
+        for (auto dev : outputs) {
+            dropped_frames += dev->dropped_frames;
+        }
+        return dropped_frames;
+    }
+
+    double DrmUtil::getRefreshRate(const modeset_dev * dev) {
+        return getRefreshRate(&dev->mode);
+    }
+
+    double DrmUtil::getRefreshRate(const drmModeModeInfo * mode) {
+        if (!mode->htotal || !mode->vtotal) {
+            return mode->vrefresh;
+        }
+        double refresh = mode->clock * 1000.0 / ((double)mode->htotal * mode->vtotal);
+        if (mode->flags & DRM_MODE_FLAG_INTERLACE) {
+            refresh *= 2;
+        }
+        if (mode->flags & DRM_MODE_FLAG_DBLSCAN) {
+            refresh /= 2;
+        }
+        if (mode->vscan > 1) {
+            refresh /= mode->vscan;
+        }
+        return refresh;
+    }
+
+    /**
+     * Decimal digits only: no sign, no blanks, nothing that does not fit 16 bits like the sizes of a mode
+     */
+    static bool parseDimension(const char ** p, uint32_t * value) {
+        if (!isdigit((unsigned char)**p)) {
+            return false;
+        }
+        char * end;
+        errno = 0;
+        unsigned long n = strtoul(*p, &end, 10);
+        if (errno || n > UINT16_MAX) {
+            return false;
+        }
+        *value = n;
+        *p = end;
+        return true;
+    }
+
+    int32_t DrmUtil::parseModeSpec(const char * spec, mode_spec * out) {
+        *out = { MODE_FIRST, 0, 0, 0 };
+        if (!spec || !*spec || !strcmp(spec, "first")) {
+            return 0;
+        }
+        if (!strcmp(spec, "preferred")) {
+            out->selection = MODE_PREFERRED;
+            return 0;
+        }
+        if (!strcmp(spec, "max-refresh")) {
+            out->selection = MODE_MAX_REFRESH;
+            return 0;
+        }
+
+        uint32_t width = 0, height = 0;
+        double refresh = 0;
+        const char * p = spec;
+        bool valid = parseDimension(&p, &width) && *p++ == 'x' && parseDimension(&p, &height);
+        if (valid && *p == '@') {
+            p++;
+            /* strtod would take a sign, blanks, inf and nan too */
+            char * end;
+            valid = isdigit((unsigned char)*p);
+            refresh = valid ? strtod(p, &end) : 0;
+            p = valid ? end : p;
+        }
+        if (!valid || *p || !width || !height) {
+            std::clog << "invalid mode '" << spec << "', expected first, preferred, max-refresh, WxH or WxH@Hz" << std::endl;
+            return -EINVAL;
+        }
+        *out = { MODE_SIZE, width, height, refresh };
+        return 0;
+    }
+
+    void DrmUtil::setModeSpec(mode_spec spec) {
+        requested_mode = spec;
+    }
+
+    std::vector<drmModeModeInfo> DrmUtil::getModes(const modeset_dev * dev) {
+        std::vector<drmModeModeInfo> modes;
+        drmModeConnector *conn = drmModeGetConnector(fd, dev->conn);
+        if (!conn) {
+            std::clog << "cannot retrieve DRM connector " << dev->conn << " (" << errno << ")" << std::endl;
+            return modes;
+        }
+        modes.assign(conn->modes, conn->modes + conn->count_modes);
+        drmModeFreeConnector(conn);
+        return modes;
+    }
+
+    /**
+     * Ties on refresh rate go to the preferred mode, then to the one listed first. A size the connector
+     * does not have falls back to the preferred mode
+     */
+    int32_t DrmUtil::selectMode(const drmModeModeInfo * modes, int32_t count_modes, const mode_spec * spec) {
+        if (count_modes <= 0) {
+            return -1;
+        }
+        int32_t preferred = 0;
+        for (int32_t i = 0; i < count_modes; i++) {
+            if (modes[i].type & DRM_MODE_TYPE_PREFERRED) {
+                preferred = i;
+                break;
+            }
+        }
+
+        int32_t best = -1;
+        double best_score = 0;
+        for (int32_t i = 0; i < count_modes; i++) {
+            double refresh = getRefreshRate(&modes[i]);
+            double score;
+            switch (spec->selection) {
+                case MODE_MAX_REFRESH:
+                    score = refresh;
+                    break;
+                case MODE_SIZE:
+                    if (modes[i].hdisplay != spec->width || modes[i].vdisplay != spec->height) {
+                        continue;
+                    }
+                    score = spec->refresh > 0 ? -std::abs(refresh - spec->refresh) : refresh;
+                    break;
+                default:
+                    continue;
+            }
+            /* below 0.01 Hz it is the same rate, 59.94 and 60 are not */
+            if (best < 0 || score > best_score + 0.01 ||
+                    (score > best_score - 0.01 && i == preferred)) {
+                best = i;
+                best_score = score;
+            }
+        }
+
+        switch (spec->selection) {
+            case MODE_FIRST:
+                return 0;
+            case MODE_PREFERRED:
+                return preferred;
+            default:
+                if (best < 0) {
+                    std::clog << "no " << spec->width << "x" << spec->height << " mode, using the preferred one" << std::endl;
+                    return preferred;
+                }
+                return best;
+        }
+    }
+
+    /**
+     *
+     */
+    void DrmUtil::submitQueued(modeset_dev * dev) {
+        if (dev->queued_buf < 0) {
+            return;
+        }
+        int32_t idx = dev->queued_buf;
+        dev->queued_buf = -1;
+        int32_t ret = atomic
+            ? atomicFlip(dev, idx)
+            : drmModePageFlip(fd, dev->crtc, dev->bufs[idx].fb, DRM_MODE_PAGE_FLIP_EVENT, dev);
+        if (ret) {
+            std::clog << "cannot page flip CRTC for connector " << dev->conn << " (" << errno << ")" << std::endl;
+            dev->buf_state[idx] = BUF_FREE;
+            dev->dropped_frames++;
+            return;
+        }
+        /* front_buf changes in page_flip_handler, when the buffer is really on the screen */
+        dev->buf_state[idx] = BUF_FLIPPING;
+        dev->flip_buf = idx;
+    }
+
+    /**
+     * Nonblocking atomic commit of the new FB_ID on the primary plane. The plane is already bound to the
+     * CRTC by the modeset of initDrmDev, so nothing else changes. The completion comes as a page flip event
+     */
+    int32_t DrmUtil::atomicFlip(modeset_dev * dev, int32_t idx) {
+        drmModeAtomicReq * req = drmModeAtomicAlloc();
+        if (!req) {
+            return -ENOMEM;
+        }
+        drmModeAtomicAddProperty(req, dev->plane, dev->prop_fb_id, dev->bufs[idx].fb);
+
+        uint32_t damage_blob = 0;
+        if (dev->prop_fb_damage_clips && dev->has_damage[idx]) {
+            if (drmModeCreatePropertyBlob(fd, &dev->damage[idx], sizeof(drm_mode_rect), &damage_blob)) {
+                /* without the clips the whole plane is updated, still correct */
+                damage_blob = 0;
+            } else {
+                drmModeAtomicAddProperty(req, dev->plane, dev->prop_fb_damage_clips, damage_blob);
+            }
+        }
+
+        int32_t ret = drmModeAtomicCommit(fd, req, DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, dev);
+        if (ret) {
+            std::clog << "atomic commit failed for connector " << dev->conn << " (" << errno << ")" << std::endl;
+        }
+
+        /* the committed state holds its own reference to the blob */
+        if (damage_blob) {
+            drmModeDestroyPropertyBlob(fd, damage_blob);
+        }
+        drmModeAtomicFree(req);
+        return ret;
+    }
+
+    /**
+     * Finds the primary plane that can scan out on the CRTC of dev and the ids of its FB_ID and
+     * FB_DAMAGE_CLIPS properties
+     */
+    int32_t DrmUtil::modeset_find_plane(int32_t fd, modeset_dev *dev) {
+        drmModeRes *res;
+        drmModePlaneRes *plane_res;
+        int32_t crtc_idx = -1;
+        uint32_t i, j;
+
+        res = drmModeGetResources(fd);
+        if (!res) {
+            return -errno;
+        }
+        for (i = 0; i < res->count_crtcs; ++i) {
+            if (res->crtcs[i] == dev->crtc) {
+                crtc_idx = i;
+            }
+        }
+        drmModeFreeResources(res);
+
+        plane_res = drmModeGetPlaneResources(fd);
+        if (!plane_res || crtc_idx < 0) {
+            std::clog << "cannot retrieve the planes of CRTC " << dev->crtc << std::endl;
+            return -ENOENT;
+        }
+
+        dev->plane = 0;
+        for (i = 0; i < plane_res->count_planes && !dev->plane; ++i) {
+            drmModePlane *plane = drmModeGetPlane(fd, plane_res->planes[i]);
+            if (!plane) {
+                continue;
+            }
+            bool usable = plane->possible_crtcs & (1 << crtc_idx);
+            uint32_t plane_id = plane->plane_id;
+            drmModeFreePlane(plane);
+            if (!usable) {
+                continue;
+            }
+
+            drmModeObjectProperties *props = drmModeObjectGetProperties(fd, plane_id, DRM_MODE_OBJECT_PLANE);
+            if (!props) {
+                continue;
+            }
+            bool primary = false;
+            uint32_t prop_fb_id = 0;
+            uint32_t prop_fb_damage_clips = 0;
+            for (j = 0; j < props->count_props; ++j) {
+                drmModePropertyRes *prop = drmModeGetProperty(fd, props->props[j]);
+                if (!prop) {
+                    continue;
+                }
+                if (!strcmp(prop->name, "type")) {
+                    primary = props->prop_values[j] == DRM_PLANE_TYPE_PRIMARY;
+                } else if (!strcmp(prop->name, "FB_ID")) {
+                    prop_fb_id = prop->prop_id;
+                } else if (!strcmp(prop->name, "FB_DAMAGE_CLIPS")) {
+                    prop_fb_damage_clips = prop->prop_id;
+                }
+                drmModeFreeProperty(prop);
+            }
+            drmModeFreeObjectProperties(props);
+
+            if (primary && prop_fb_id) {
+                dev->plane = plane_id;
+                dev->prop_fb_id = prop_fb_id;
+                dev->prop_fb_damage_clips = prop_fb_damage_clips;
+            }
+        }
+        drmModeFreePlaneResources(plane_res);
+
+        if (!dev->plane) {
+            std::clog << "no primary plane for CRTC " << dev->crtc << std::endl;
+            return -ENOENT;
+        }
+        std::clog << "primary plane " << dev->plane << " for CRTC " << dev->crtc
+            << (dev->prop_fb_damage_clips ? ", with damage clips" : ", without damage clips") << std::endl;
+        return 0;
+    }
+
+    void DrmUtil::setBufferFreeCallback(BufferFreeCallback callback, void * user_data) {
+        buffer_free_callback = callback;
+        buffer_free_user_data = user_data;
+    }
+
+    /**
+     *
+     */
+    void DrmUtil::page_flip_handler(int fd, unsigned int sequence, unsigned int tv_sec,
+            unsigned int tv_usec, void * user_data) {
+        modeset_dev * dev = (modeset_dev *) user_data;
+        DrmUtil * drm = dev->drm;
+        if (dev->flip_buf < 0) {
+            return;
+        }
+        int32_t old_front = dev->front_buf;
+        dev->buf_state[old_front] = BUF_FREE;
+        dev->buf_state[dev->flip_buf] = BUF_SCANOUT;
+        dev->front_buf = dev->flip_buf;
+        dev->flip_buf = -1;
+
+        /* the next frame may already wait for this vblank */
+        drm->submitQueued(dev);
+
+        if (drm->buffer_free_callback) {
+            drm->buffer_free_callback(&dev->bufs[old_front], drm->buffer_free_user_data);
+        }
+    }
+
+    /**
+     *
+     */
+    int32_t DrmUtil::handleEvents(int32_t timeout_ms) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+
+        int32_t ret = poll(&pfd, 1, timeout_ms);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                return 0;
+            }
+            std::clog << "poll on the drm device failed (" << errno << ")" << std::endl;
+            return -errno;
+        }
+        if (ret == 0) {
+            return -ETIMEDOUT;
+        }
+
+        drmEventContext ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.version = 2;
+        ev.page_flip_handler = page_flip_handler;
+        if (drmHandleEvent(fd, &ev)) {
+            std::clog << "cannot handle drm events (" << errno << ")" << std::endl;
+            return -errno;
+        }
+        return 0;
+    }
+
+    void DrmUtil::waitForFlip() {
+        for (auto dev : outputs) {
+            waitForFlip(dev);
+        }
+    }
+
+    void DrmUtil::waitForFlip(modeset_dev * dev) {
+        while (dev->flip_buf >= 0) {
+            if (handleEvents(-1)) {
+                /* the event will not come, do not hang */
+                dev->buf_state[dev->flip_buf] = BUF_FREE;
+                dev->flip_buf = -1;
+            }
         }
     }
 
@@ -366,6 +858,7 @@ err_destroy:
     int32_t DrmUtil::initDrmDev() {
         int32_t ret;
         modeset_buf *buf;
+        modeset_dev *dev;
 
         /* open the DRM device */
         ret = modeset_open(&fd, _card);
@@ -373,6 +866,13 @@ err_destroy:
             goto out_return;
         }
 
+        /* atomic commits need the planes exposed as objects */
+        if (atomic && (drmSetClientCap(fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) ||
+                    drmSetClientCap(fd, DRM_CLIENT_CAP_ATOMIC, 1))) {
+            std::clog << "no atomic modesetting on '" << _card << "', using page flips" << std::endl;
+            atomic = false;
+        }
+
         /* prepare all connectors and CRTCs */
         ret = modeset_prepare(fd);
         if (ret) {
@@ -380,19 +880,38 @@ err_destroy:
         }
 
         /* perform actual modesetting on each found connector+CRTC */
-        for (mdev = modeset_list; mdev; mdev = mdev->next) {
-            mdev->saved_crtc = drmModeGetCrtc(fd, mdev->crtc);
-            buf = &mdev->bufs[mdev->front_buf];
-            ret = drmModeSetCrtc(fd, mdev->crtc, buf->fb, 0, 0,
-                    &mdev->conn, 1, &mdev->mode);
+        for (dev = modeset_list; dev; dev = dev->next) {
+            dev->saved_crtc = drmModeGetCrtc(fd, dev->crtc);
+            buf = &dev->bufs[dev->front_buf];
+            ret = drmModeSetCrtc(fd, dev->crtc, buf->fb, 0, 0,
+                    &dev->conn, 1, &dev->mode);
             if (ret) {
-                std::clog << "cannot set CRTC for connector " << mdev->conn << "(" 
+                std::clog << "cannot set CRTC for connector " << dev->conn << "(" 
                     << errno << ")" << std::endl;
-            } else {
-                // found an active modeset device
+                continue;
+            }
+            // found an active modeset device
+            dev->buf_state[dev->front_buf] = BUF_SCANOUT;
+            outputs.push_back(dev);
+            std::clog << "output " << outputs.size() - 1 << ": connector " << dev->conn << ", CRTC " << dev->crtc
+                << ", " << getWidth(dev) << "x" << getHeight(dev) << "@" << getRefreshRate(dev) << std::endl;
+            if (!all_outputs) {
                 break;
             }
         }
+        if (outputs.empty()) {
+            std::clog << "no output could be set up on '" << _card << "'" << std::endl;
+            return -ENODEV;
+        }
+        mdev = outputs[0];
+
+        /* one primary plane per CRTC, every output has to have one to stay atomic */
+        for (auto out : outputs) {
+            if (atomic && modeset_find_plane(fd, out)) {
+                std::clog << "using page flips instead of atomic commits" << std::endl;
+                atomic = false;
+            }
+        }
 
         return 0;
 
@@ -4,6 +4,7 @@
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 #include <cstdint>
+#include <vector>
 
 namespace szilv {
 
@@ -18,31 +19,154 @@ namespace szilv {
         uint32_t fb;
     };
 
+    const uint32_t MODESET_MIN_BUFFERS = 2;
+    const uint32_t MODESET_MAX_BUFFERS = 4;
+
+    // where a swapchain buffer is:
+    // FREE -acquire-> DRAWING -present-> QUEUED -flip submitted-> FLIPPING -flip event-> SCANOUT -next flip event-> FREE
+    // release takes a DRAWING buffer back to FREE, a newer present takes a QUEUED one back to FREE (dropped frame)
+    enum BufferState {
+        BUF_FREE,
+        BUF_DRAWING,
+        BUF_QUEUED,
+        BUF_FLIPPING,
+        BUF_SCANOUT
+    };
+
+    // how the mode of a connector is chosen
+    enum ModeSelection {
+        MODE_FIRST,         // conn->modes[0], the first one the driver lists
+        MODE_PREFERRED,     // the one flagged DRM_MODE_TYPE_PREFERRED, usually the native resolution
+        MODE_MAX_REFRESH,   // the highest refresh rate, the preferred mode on ties
+        MODE_SIZE           // width x height at the refresh closest to the given one, or at the highest one
+    };
+
+    typedef struct mode_spec mode_spec;
+    struct mode_spec {
+        ModeSelection selection;
+        uint32_t width;
+        uint32_t height;
+        // Hz, 0: the highest refresh of the size
+        double refresh;
+    };
+
+    class DrmUtil;
+
+    // one output: a connector with its CRTC, mode and swapchain
     typedef struct modeset_dev modeset_dev;
     struct modeset_dev {
         modeset_dev *next;
         
         int32_t front_buf;
-        modeset_buf bufs[2];
+        uint32_t nr_of_bufs;
+        modeset_buf bufs[MODESET_MAX_BUFFERS];
+        BufferState buf_state[MODESET_MAX_BUFFERS];
+        // the region present was told about, sent as FB_DAMAGE_CLIPS with the atomic flip
+        drm_mode_rect damage[MODESET_MAX_BUFFERS];
+        bool has_damage[MODESET_MAX_BUFFERS];
 
         drmModeModeInfo mode;
         uint32_t conn;
         uint32_t crtc;
         drmModeCrtc *saved_crtc;
+
+        // atomic modesetting: the primary plane of the CRTC and its property ids, 0 if the driver lacks it
+        uint32_t plane;
+        uint32_t prop_fb_id;
+        uint32_t prop_fb_damage_clips;
+
+        // page flips of this CRTC: the buffer of the submitted flip and the one waiting for the next flip, -1 if none
+        int32_t flip_buf;
+        int32_t queued_buf;
+        uint32_t dropped_frames;
+        // the page flip events carry the modeset_dev, this leads back to the callback
+        DrmUtil * drm;
     };
 
+    // called from handleEvents when a page flip completed, buf is the buffer that left the screen
+    typedef void (*BufferFreeCallback)(modeset_buf * buf, void * user_data);
+
     class DrmUtil {
         public:
-            DrmUtil(const char * card);
+            // page_flip: presenting queues a drmModePageFlip for the next vblank instead of a drmModeSetCrtc
+            // nr_of_bufs: the size of the swapchain, MODESET_MIN_BUFFERS..MODESET_MAX_BUFFERS
+            // atomic: flips are nonblocking atomic commits of FB_ID on the primary plane, with damage clips;
+            // falls back to page flips when the driver has no atomic support
+            // all_outputs: sets a mode on every connected connector with a free CRTC, not only on the first one
+            DrmUtil(const char * card, bool page_flip = false, uint32_t nr_of_bufs = 2, bool atomic = false,
+                    bool all_outputs = false);
             ~DrmUtil();
+            // the first output, the single output API works on it
             modeset_dev * mdev;
             virtual int32_t initDrmDev();
+
+            // the outputs with a mode set, mdev is the first one. Each has its own swapchain and flips on
+            // its own vblank; present, release and the events find the output of a buffer by its address
+            uint32_t getNrOfOutputs() { return outputs.size(); }
+            modeset_dev * getOutput(uint32_t i) { return outputs[i]; }
+            static uint32_t getWidth(const modeset_dev * dev) { return dev->bufs[0].width; }
+            static uint32_t getHeight(const modeset_dev * dev) { return dev->bufs[0].height; }
+            // in Hz, from the pixel clock of the mode, more precise than mode.vrefresh
+            static double getRefreshRate(const modeset_dev * dev);
+            static double getRefreshRate(const drmModeModeInfo * mode);
+
+            // modes. The spec applies to the outputs set up by a later initDrmDev, the default is MODE_FIRST
+            // parses "first", "preferred", "max-refresh", "WxH" or "WxH@Hz". Returns 0 or -EINVAL
+            static int32_t parseModeSpec(const char * spec, mode_spec * out);
+            virtual void setModeSpec(mode_spec spec);
+            // every mode the connector of dev offers, in the order of the driver
+            virtual std::vector<drmModeModeInfo> getModes(const modeset_dev * dev);
+            // the index of the mode spec picks from the modes, -1 if there is no mode at all
+            static int32_t selectMode(const drmModeModeInfo * modes, int32_t count_modes, const mode_spec * spec);
+            // presents bufs[front_buf ^ 1], for callers that draw into it without acquire
             virtual void swap_buffers();
 
+            // swapchain. acquire returns a free buffer to draw into; when none is free it waits for a flip
+            // event, or returns nullptr if block is false. The flip events already pending are handled first
+            virtual modeset_buf * acquire(bool block = true);
+            virtual modeset_buf * acquire(modeset_dev * dev, bool block);
+            // hands a drawn buffer to the display. In page flip mode it never waits: the buffer is flipped
+            // at the next vblank, or replaces the buffer waiting for it. damage is the rectangle that changed
+            // (x2, y2 exclusive), without it the whole buffer counts as changed
+            virtual void present(modeset_buf * buf, const drm_mode_rect * damage = nullptr);
+            // gives an acquired buffer back without showing it
+            virtual void release(modeset_buf * buf);
+            BufferState getBufferState(uint32_t idx) { return mdev->buf_state[idx]; }
+            // summed over the outputs
+            uint32_t getDroppedFrames();
+
+            // page flip mode
+            virtual void setBufferFreeCallback(BufferFreeCallback callback, void * user_data);
+            // dispatches the DRM events, waits at most timeout_ms (-1: forever). Returns 0, -ETIMEDOUT or -errno
+            virtual int32_t handleEvents(int32_t timeout_ms);
+            // blocks until the presented buffers are on the screen, with two buffers bufs[front_buf ^ 1] is free afterwards
+            virtual void waitForFlip();
+            virtual void waitForFlip(modeset_dev * dev);
+            bool isFlipPending() { return mdev->flip_buf >= 0; }
+            static bool isFlipPending(const modeset_dev * dev) { return dev->flip_buf >= 0; }
+            bool isPageFlip() { return page_flip; }
+            bool isAtomic() { return atomic; }
+            int32_t getFd() { return fd; }
+
         private:
             const char * _card;
             int32_t fd;
             modeset_dev *modeset_list = NULL;
+            bool page_flip;
+            bool atomic;
+            bool all_outputs;
+            mode_spec requested_mode = { MODE_FIRST, 0, 0, 0 };
+            uint32_t nr_of_bufs;
+            std::vector<modeset_dev *> outputs;
+            BufferFreeCallback buffer_free_callback = nullptr;
+            void * buffer_free_user_data = nullptr;
+
+            virtual modeset_dev * outputOf(modeset_buf * buf);
+            virtual void submitQueued(modeset_dev * dev);
+            virtual int32_t atomicFlip(modeset_dev * dev, int32_t idx);
+            virtual int32_t modeset_find_plane(int32_t fd, modeset_dev *dev);
+            static void page_flip_handler(int fd, unsigned int sequence, unsigned int tv_sec,
+                    unsigned int tv_usec, void * user_data);
 
             virtual int32_t modeset_open(int32_t *out, const char *node);
             virtual void modeset_cleanup(int32_t fd);
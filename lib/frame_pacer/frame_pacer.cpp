@@ -0,0 +1,89 @@
+#include <iostream>
+#include <thread>
+#include <algorithm>
+
+#include "frame_pacer.hpp"
+
+namespace szilv {
+
+    // the sleep of the OS overshoots by up to a few hundred microseconds, the end is spun
+    const std::chrono::nanoseconds PACER_SPIN_MARGIN(300000);
+    // a frame overruns above this part of the budget, has headroom below the other one
+    const double PACER_OVERRUN_RATIO = 0.95;
+    const double PACER_HEADROOM_RATIO = 0.5;
+    // consecutive frames before a hint, and the frames a change gets to take effect
+    const uint32_t PACER_OVERRUN_FRAMES = 3;
+    const uint32_t PACER_HEADROOM_FRAMES = 120;
+    const uint32_t PACER_COOLDOWN_FRAMES = 30;
+
+    FramePacer::FramePacer(double target_fps) {
+        setTargetFps(target_fps);
+    }
+
+    void FramePacer::setTargetFps(double target_fps) {
+        this->target_fps = std::max(1.0, target_fps);
+        budget = std::chrono::nanoseconds((int64_t)(1e9 / this->target_fps));
+        started = false;
+        std::clog << "frame pacer at " << this->target_fps << " fps, " << budget.count() / 1000 << " us per frame" << std::endl;
+    }
+
+    void FramePacer::setHintCallback(PacerCallback callback, void * user_data) {
+        this->callback = callback;
+        this->callback_user_data = user_data;
+    }
+
+    void FramePacer::beginFrame() {
+        frame_start = clock::now();
+        if (!started) {
+            deadline = frame_start + budget;
+            started = true;
+        }
+    }
+
+    void FramePacer::waitForNextFrame() {
+        clock::time_point now = clock::now();
+        last_work = now - frame_start;
+        frames++;
+        updateHints();
+
+        if (now >= deadline) {
+            // late: the next deadline is the next period boundary after now, the skipped ones are lost
+            overruns++;
+            deadline += budget * ((now - deadline) / budget + 1);
+            return;
+        }
+        if (deadline - now > PACER_SPIN_MARGIN) {
+            std::this_thread::sleep_until(deadline - PACER_SPIN_MARGIN);
+        }
+        while (clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        deadline += budget;
+    }
+
+    void FramePacer::updateHints() {
+        double work = last_work.count();
+        avg_work_ns = frames == 1 ? work : avg_work_ns * 0.9 + work * 0.1;
+        double budget_ns = budget.count();
+
+        overrun_streak = work > budget_ns * PACER_OVERRUN_RATIO ? overrun_streak + 1 : 0;
+        headroom_streak = avg_work_ns < budget_ns * PACER_HEADROOM_RATIO ? headroom_streak + 1 : 0;
+        if (cooldown) {
+            cooldown--;
+            return;
+        }
+        if (!callback) {
+            return;
+        }
+        if (overrun_streak >= PACER_OVERRUN_FRAMES) {
+            callback(PACER_OVERRUN, callback_user_data);
+        } else if (headroom_streak >= PACER_HEADROOM_FRAMES) {
+            callback(PACER_HEADROOM, callback_user_data);
+        } else {
+            return;
+        }
+        overrun_streak = 0;
+        headroom_streak = 0;
+        cooldown = PACER_COOLDOWN_FRAMES;
+    }
+}
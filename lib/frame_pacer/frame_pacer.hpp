@@ -0,0 +1,65 @@
+#if !defined(FRAME_PACER_H)
+#define FRAME_PACER_H
+
+#include <cstdint>
+#include <chrono>
+
+namespace szilv {
+
+    // what the frame times suggest to the application, see FramePacer::setHintCallback
+    enum PacerHint {
+        PACER_OVERRUN,      // the frames keep missing the deadline: more workers or a lower resolution
+        PACER_HEADROOM      // the frames keep finishing early: workers can be parked or the resolution raised
+    };
+
+    typedef void (*PacerCallback)(PacerHint hint, void * user_data);
+
+    // Runs the render loop at a fixed frame rate instead of as fast as it can: after a frame it sleeps
+    // until the deadline of the next one and spins only the last part for precision. The work time of
+    // every frame (beginFrame to waitForNextFrame) is compared to the budget; when the frames overrun or
+    // leave a lot of headroom for a while, the callback gets a hint, at most once per cooldown.
+    class FramePacer {
+        public:
+            FramePacer(double target_fps);
+
+            virtual void setTargetFps(double target_fps);
+            double getTargetFps() { return target_fps; }
+            int64_t getBudgetNanos() { return budget.count(); }
+
+            // the start of the frame work
+            virtual void beginFrame();
+            // sleeps until the deadline of the next frame. A late frame does not wait, the deadlines move
+            // on to the next period boundary instead of trying to catch up
+            virtual void waitForNextFrame();
+
+            virtual void setHintCallback(PacerCallback callback, void * user_data);
+
+            int64_t getLastWorkNanos() { return last_work.count(); }
+            uint64_t getFrames() { return frames; }
+            uint64_t getOverruns() { return overruns; }
+
+        private:
+            typedef std::chrono::steady_clock clock;
+
+            double target_fps;
+            std::chrono::nanoseconds budget;
+            clock::time_point deadline;
+            clock::time_point frame_start;
+            bool started = false;
+            std::chrono::nanoseconds last_work {0};
+            // exponentially smoothed work time
+            double avg_work_ns = 0;
+
+            uint64_t frames = 0;
+            uint64_t overruns = 0;
+            uint32_t overrun_streak = 0;
+            uint32_t headroom_streak = 0;
+            uint32_t cooldown = 0;
+            PacerCallback callback = nullptr;
+            void * callback_user_data = nullptr;
+
+            virtual void updateHints();
+    };
+}
+
+#endif /* !defined(FRAME_PACER_H) */
@@ -0,0 +1,82 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include "offscreen.hpp"
+
+namespace szilv {
+
+    const uint32_t OFFSCREEN_ALIGNMENT = 64;
+
+    OffscreenTarget::OffscreenTarget(uint32_t width, uint32_t height) {
+        this->width = width;
+        this->height = height;
+        mdev = new offscreen_dev();
+    }
+
+    OffscreenTarget::~OffscreenTarget() {
+        destroy_buf(&mdev->bufs[0]);
+        destroy_buf(&mdev->bufs[1]);
+        delete mdev;
+    }
+
+    /**
+     * Allocates both buffers. Returns 0 or a negative errno like DrmUtil::initDrmDev
+     */
+    int32_t OffscreenTarget::initDev() {
+        if (!width || !height) {
+            std::cerr << "invalid offscreen size " << width << "x" << height << std::endl;
+            return -EINVAL;
+        }
+        for (auto & buf : mdev->bufs) {
+            int32_t ret = create_buf(&buf);
+            if (ret) {
+                return ret;
+            }
+        }
+        mdev->front_buf = 0;
+        std::clog << "offscreen target " << width << "x" << height << ", stride " << mdev->bufs[0].stride << std::endl;
+        return 0;
+    }
+
+    /**
+     * Nothing scans out, only the roles of the two buffers change
+     */
+    void OffscreenTarget::swap_buffers() {
+        mdev->front_buf ^= 1;
+    }
+
+    int32_t OffscreenTarget::create_buf(offscreen_buf * buf) {
+        buf->width = width;
+        buf->height = height;
+        buf->stride = (width * sizeof(uint32_t) + OFFSCREEN_ALIGNMENT - 1) / OFFSCREEN_ALIGNMENT * OFFSCREEN_ALIGNMENT;
+        buf->size = buf->stride * height;
+
+        void * map = nullptr;
+        if (posix_memalign(&map, OFFSCREEN_ALIGNMENT, buf->size)) {
+            std::cerr << "cannot allocate offscreen buffer: " << strerror(ENOMEM) << std::endl;
+            return -ENOMEM;
+        }
+        // clear the buffer to 0, like a fresh dumb buffer
+        std::memset(map, 0, buf->size);
+        buf->map = (int32_t *)map;
+        return 0;
+    }
+
+    void OffscreenTarget::destroy_buf(offscreen_buf * buf) {
+        free(buf->map);
+        buf->map = nullptr;
+    }
+
+    uint64_t OffscreenTarget::checksum(const offscreen_buf * buf) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (uint32_t y = 0; y < buf->height; y++) {
+            const uint8_t * row = (const uint8_t *)buf->map + y * buf->stride;
+            for (uint32_t i = 0; i < buf->width * sizeof(uint32_t); i++) {
+                hash = (hash ^ row[i]) * 1099511628211ULL;
+            }
+        }
+        return hash;
+    }
+}
@@ -0,0 +1,46 @@
+#if !defined(OFFSCREEN_H)
+#define OFFSCREEN_H
+
+#include <cstdint>
+
+namespace szilv {
+
+    // same meaning as the fields of modeset_buf: XRGB8888 pixels, stride bytes per row, size = stride * height
+    typedef struct offscreen_buf offscreen_buf;
+    struct offscreen_buf {
+        uint32_t width;
+        uint32_t height;
+        uint32_t stride;
+        uint32_t size;
+        int32_t *map;
+    };
+
+    typedef struct offscreen_dev offscreen_dev;
+    struct offscreen_dev {
+        int32_t front_buf;
+        offscreen_buf bufs[2];
+    };
+
+    // A render target in plain heap memory with the layout of the DRM dumb buffers, so the draw code
+    // runs unchanged on machines without a display. Rows start 64 byte aligned like the dumb buffer pitch.
+    class OffscreenTarget {
+        public:
+            OffscreenTarget(uint32_t width, uint32_t height);
+            ~OffscreenTarget();
+            offscreen_dev * mdev;
+            virtual int32_t initDev();
+            virtual void swap_buffers();
+
+            // FNV-1a over the visible pixels, to compare the output of two runs
+            static uint64_t checksum(const offscreen_buf * buf);
+
+        private:
+            uint32_t width;
+            uint32_t height;
+
+            virtual int32_t create_buf(offscreen_buf * buf);
+            virtual void destroy_buf(offscreen_buf * buf);
+    };
+}
+
+#endif /* !defined(OFFSCREEN_H) */
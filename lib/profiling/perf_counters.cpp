@@ -0,0 +1,181 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perf_counters.hpp"
+
+namespace szilv {
+
+    static const uint64_t event_configs[PERF_EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    static const char * event_names[PERF_EVENT_COUNT] = {
+        "cycles", "instructions", "cache-misses", "branch-misses"
+    };
+
+    // every worker would report the same failure, once is enough
+    static std::atomic<bool> failure_reported(false);
+
+    static int32_t perf_event_open(perf_event_attr * attr, int32_t group_fd) {
+        // pid 0, cpu -1: the calling thread on any CPU
+        return syscall(__NR_perf_event_open, attr, 0, -1, group_fd, 0);
+    }
+
+    PerfCounters::PerfCounters() {
+        for (uint32_t i = 0; i < PERF_EVENT_COUNT; i++) {
+            fds[i] = -1;
+            position[i] = -1;
+        }
+    }
+
+    PerfCounters::~PerfCounters() {
+        for (uint32_t i = 0; i < PERF_EVENT_COUNT; i++) {
+            if (fds[i] >= 0) {
+                close(fds[i]);
+            }
+        }
+    }
+
+    const char * PerfCounters::getEventName(uint32_t event) {
+        return event < PERF_EVENT_COUNT ? event_names[event] : "unknown";
+    }
+
+    int32_t PerfCounters::open() {
+        if (isOpen()) {
+            return 0;
+        }
+        int32_t first_error = 0;
+        for (uint32_t i = 0; i < PERF_EVENT_COUNT; i++) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = event_configs[i];
+            // user space only, perf_event_paranoid 2 still allows that for the own threads
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            int32_t fd = perf_event_open(&attr, leader_fd);
+            if (fd < 0) {
+                first_error = first_error ? first_error : -errno;
+                continue;
+            }
+            if (leader_fd < 0) {
+                leader_fd = fd;
+            }
+            fds[i] = fd;
+            position[i] = nr_of_events++;
+        }
+        if (!isOpen()) {
+            if (!failure_reported.exchange(true)) {
+                std::clog << "perf_event_open: " << strerror(-first_error)
+                    << ", hardware counters unavailable (perf_event_paranoid, container?)" << std::endl;
+            }
+            return first_error;
+        }
+        return 0;
+    }
+
+    bool PerfCounters::read(perf_sample * sample) {
+        if (!isOpen()) {
+            return false;
+        }
+        // nr, time_enabled, time_running, then the values in the order of opening
+        uint64_t data[3 + PERF_EVENT_COUNT];
+        ssize_t size = ::read(leader_fd, data, sizeof(data));
+        if (size < (ssize_t)((3 + nr_of_events) * sizeof(uint64_t))) {
+            return false;
+        }
+        uint64_t enabled = data[1];
+        uint64_t running = data[2];
+        for (uint32_t i = 0; i < PERF_EVENT_COUNT; i++) {
+            if (position[i] < 0) {
+                sample->value[i] = 0;
+                continue;
+            }
+            uint64_t value = data[3 + position[i]];
+            sample->value[i] = running && running < enabled
+                ? (uint64_t)((double)value * enabled / running)
+                : value;
+        }
+        return true;
+    }
+
+    PerfScope::PerfScope(perf_worker * worker, uint64_t pixels) : worker(worker), pixels(pixels) {
+        if (!worker) {
+            return;
+        }
+        if (!worker->open_tried) {
+            worker->open_tried = true;
+            worker->counters.open();
+        }
+        counting = worker->counters.read(&start);
+    }
+
+    PerfScope::~PerfScope() {
+        if (!worker) {
+            return;
+        }
+        perf_sample end;
+        if (counting && worker->counters.read(&end)) {
+            for (uint32_t i = 0; i < PERF_EVENT_COUNT; i++) {
+                worker->total.value[i] += end.value[i] - start.value[i];
+            }
+        }
+        worker->pixels += pixels;
+        worker->slices++;
+    }
+
+    static void writeRatio(std::ostream & out, bool available, double value, double per) {
+        out << std::setw(14);
+        if (available && per > 0) {
+            out << value / per;
+        } else {
+            out << "n/a";
+        }
+    }
+
+    void writePerfReport(std::ostream & out, std::vector<perf_worker> & workers) {
+        perf_worker all;
+        bool available[PERF_EVENT_COUNT] = {};
+        for (auto & w : workers) {
+            for (uint32_t i = 0; i < PERF_EVENT_COUNT; i++) {
+                all.total.value[i] += w.total.value[i];
+                available[i] = available[i] || w.counters.isAvailable(i);
+            }
+            all.pixels += w.pixels;
+            all.slices += w.slices;
+        }
+
+        out << std::fixed << std::setprecision(3);
+        out << "worker         slices        pixels           IPC  cycles/pixel  cache-miss/px  branch-miss/px" << std::endl;
+        for (uint32_t i = 0; i <= workers.size(); i++) {
+            perf_worker & w = i < workers.size() ? workers[i] : all;
+            if (!w.slices) {
+                continue;
+            }
+            out << std::left << std::setw(10) << (i < workers.size() ? std::to_string(i) : "all") << std::right
+                << std::setw(11) << w.slices << std::setw(14) << w.pixels;
+            writeRatio(out, available[PERF_INSTRUCTIONS] && available[PERF_CYCLES],
+                    w.total.value[PERF_INSTRUCTIONS], w.total.value[PERF_CYCLES]);
+            writeRatio(out, available[PERF_CYCLES], w.total.value[PERF_CYCLES], w.pixels);
+            out << " ";
+            writeRatio(out, available[PERF_CACHE_MISSES], w.total.value[PERF_CACHE_MISSES], w.pixels);
+            out << "  ";
+            writeRatio(out, available[PERF_BRANCH_MISSES], w.total.value[PERF_BRANCH_MISSES], w.pixels);
+            out << std::endl;
+        }
+    }
+}
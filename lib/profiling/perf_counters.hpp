@@ -0,0 +1,76 @@
+#if !defined(PERF_COUNTERS_H)
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <vector>
+#include <ostream>
+
+namespace szilv {
+
+    enum PerfEvent {
+        PERF_CYCLES,
+        PERF_INSTRUCTIONS,
+        PERF_CACHE_MISSES,
+        PERF_BRANCH_MISSES,
+        PERF_EVENT_COUNT
+    };
+
+    typedef struct perf_sample perf_sample;
+    struct perf_sample {
+        uint64_t value[PERF_EVENT_COUNT];
+    };
+
+    // The hardware counters of one thread, user space only, opened as one perf_event_open group so the
+    // events are counted over the same time. The events the CPU or the kernel does not offer are left
+    // out; in a container usually none of them can be opened, then open fails and nothing is counted.
+    class PerfCounters {
+        public:
+            PerfCounters();
+            ~PerfCounters();
+
+            // counts the calling thread from now on. 0 or negative errno when no event could be opened
+            virtual int32_t open();
+            bool isOpen() { return leader_fd >= 0; }
+            bool isAvailable(uint32_t event) { return event < PERF_EVENT_COUNT && position[event] >= 0; }
+            // the counts of the thread so far, scaled up when the kernel multiplexed the counters
+            virtual bool read(perf_sample * sample);
+
+            static const char * getEventName(uint32_t event);
+
+        private:
+            int32_t leader_fd = -1;
+            int32_t fds[PERF_EVENT_COUNT];
+            // where the event is in the group read, -1: not counted
+            int32_t position[PERF_EVENT_COUNT];
+            uint32_t nr_of_events = 0;
+    };
+
+    // what one worker counted in the slices it drew
+    typedef struct perf_worker perf_worker;
+    struct perf_worker {
+        PerfCounters counters;
+        bool open_tried = false;
+        perf_sample total = {};
+        uint64_t pixels = 0;
+        uint64_t slices = 0;
+    };
+
+    // the counter difference of its scope goes to the worker, nothing if the worker is nullptr.
+    // Has to run on the thread of the worker, the counters are opened at the first scope
+    class PerfScope {
+        public:
+            PerfScope(perf_worker * worker, uint64_t pixels);
+            ~PerfScope();
+
+        private:
+            perf_worker * worker;
+            uint64_t pixels;
+            perf_sample start;
+            bool counting = false;
+    };
+
+    // IPC and the misses per pixel of every worker and of all of them
+    void writePerfReport(std::ostream & out, std::vector<perf_worker> & workers);
+}
+
+#endif /* !defined(PERF_COUNTERS_H) */
@@ -0,0 +1,220 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+
+#include "profiling.hpp"
+
+namespace szilv {
+
+    // set by SIGUSR1, only an async-signal-safe flag, endFrame does the work
+    static volatile std::sig_atomic_t dump_requested = 0;
+
+    static void sigusr1_handler(int) {
+        dump_requested = 1;
+    }
+
+    static const char * phase_names[PHASE_COUNT + 1] = {
+        "input", "geometry", "raster", "sync_wait", "present", "frame"
+    };
+
+    FrameProfiler::FrameProfiler(uint32_t nr_of_workers, uint32_t capacity)
+        : records(std::max(capacity, 1U)),
+        worker_ns((size_t)std::max(capacity, 1U) * std::min(nr_of_workers, PROFILER_MAX_WORKERS)),
+        head(0) {
+        this->nr_of_workers = std::min(nr_of_workers, PROFILER_MAX_WORKERS);
+        this->capacity = std::max(capacity, 1U);
+        for (auto & ns : worker_ns) {
+            ns.store(0, std::memory_order_relaxed);
+        }
+        memset(&current, 0, sizeof(current));
+    }
+
+    int64_t FrameProfiler::nowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    const char * FrameProfiler::getPhaseName(uint32_t phase) {
+        return phase <= PHASE_COUNT ? phase_names[phase] : "unknown";
+    }
+
+    void FrameProfiler::installSignalHandler() {
+        signal(SIGUSR1, sigusr1_handler);
+    }
+
+    void FrameProfiler::beginFrame() {
+        uint64_t frame = head.load(std::memory_order_relaxed);
+        memset(&current, 0, sizeof(current));
+        current.frame = frame;
+        current.start_ns = nowNanos();
+        current_phase = PHASE_INPUT;
+        phase_start_ns = current.start_ns;
+
+        // the row of this frame still holds the frame capacity frames ago
+        std::atomic<int64_t> * row = worker_ns.data() + (frame % capacity) * nr_of_workers;
+        for (uint32_t i = 0; i < nr_of_workers; i++) {
+            row[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void FrameProfiler::phase(FramePhase phase) {
+        int64_t now = nowNanos();
+        current.phase_ns[current_phase] += now - phase_start_ns;
+        current_phase = phase;
+        phase_start_ns = now;
+    }
+
+    void FrameProfiler::addWorkerTime(uint32_t worker_id, int64_t ns) {
+        if (worker_id >= nr_of_workers) {
+            return;
+        }
+        uint64_t frame = head.load(std::memory_order_relaxed);
+        worker_ns[(frame % capacity) * nr_of_workers + worker_id].fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    void FrameProfiler::endFrame() {
+        int64_t now = nowNanos();
+        current.phase_ns[current_phase] += now - phase_start_ns;
+        current.total_ns = now - current.start_ns;
+        uint64_t frame = head.load(std::memory_order_relaxed);
+
+        // the pool has waited for the workers, their times of this frame are final
+        std::atomic<int64_t> * row = worker_ns.data() + (frame % capacity) * nr_of_workers;
+        int64_t busiest = 0;
+        int64_t sum = 0;
+        uint32_t busy_workers = 0;
+        for (uint32_t i = 0; i < nr_of_workers; i++) {
+            int64_t ns = row[i].load(std::memory_order_relaxed);
+            if (ns > 0) {
+                busiest = std::max(busiest, ns);
+                sum += ns;
+                busy_workers++;
+            }
+        }
+        current.imbalance_permille = sum ? busiest * busy_workers * 1000 / sum : 1000;
+        last_imbalance = current.imbalance_permille / 1000.0;
+        records[frame % capacity] = current;
+        // the workers add to the next row from now on
+        head.store(frame + 1, std::memory_order_release);
+
+        if (dump_requested) {
+            dump_requested = 0;
+            dumpJson(dump_path.c_str());
+        }
+    }
+
+    percentiles FrameProfiler::computePercentiles(std::vector<int64_t> & values) {
+        percentiles p = { 0, 0, 0, 0 };
+        if (values.empty()) {
+            return p;
+        }
+        std::sort(values.begin(), values.end());
+        size_t n = values.size();
+        p.p50 = values[(n - 1) * 50 / 100];
+        p.p95 = values[(n - 1) * 95 / 100];
+        p.p99 = values[(n - 1) * 99 / 100];
+        p.max = values[n - 1];
+        return p;
+    }
+
+    percentiles FrameProfiler::getPercentiles(uint32_t phase) {
+        uint64_t frames = std::min<uint64_t>(head.load(std::memory_order_acquire), capacity);
+        std::vector<int64_t> values;
+        values.reserve(frames);
+        for (uint64_t i = 0; i < frames; i++) {
+            values.push_back(phase < PHASE_COUNT ? records[i].phase_ns[phase] : records[i].total_ns);
+        }
+        return computePercentiles(values);
+    }
+
+    percentiles FrameProfiler::getImbalancePercentiles() {
+        uint64_t frames = std::min<uint64_t>(head.load(std::memory_order_acquire), capacity);
+        std::vector<int64_t> values;
+        values.reserve(frames);
+        for (uint64_t i = 0; i < frames; i++) {
+            values.push_back(records[i].imbalance_permille);
+        }
+        return computePercentiles(values);
+    }
+
+    percentiles FrameProfiler::getWorkerPercentiles(uint32_t worker_id) {
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t frames = std::min<uint64_t>(end, capacity);
+        std::vector<int64_t> values;
+        values.reserve(frames);
+        for (uint64_t f = end - frames; f < end; f++) {
+            values.push_back(worker_ns[(f % capacity) * nr_of_workers + worker_id].load(std::memory_order_relaxed));
+        }
+        return computePercentiles(values);
+    }
+
+    /**
+     * from the start of the oldest frame in the ring to the end of the newest one
+     */
+    double FrameProfiler::getFps() {
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t frames = std::min<uint64_t>(end, capacity);
+        if (!frames) {
+            return 0;
+        }
+        const frame_record & first = records[(end - frames) % capacity];
+        const frame_record & last = records[(end - 1) % capacity];
+        int64_t span = last.start_ns + last.total_ns - first.start_ns;
+        return span > 0 ? frames * 1e9 / span : 0;
+    }
+
+    static void writePercentiles(std::ostream & out, const percentiles & p) {
+        out << "{\"p50_us\": " << p.p50 / 1000.0 << ", \"p95_us\": " << p.p95 / 1000.0
+            << ", \"p99_us\": " << p.p99 / 1000.0 << ", \"max_us\": " << p.max / 1000.0 << "}";
+    }
+
+    void FrameProfiler::writeJson(std::ostream & out) {
+        out << "{\n  \"frames\": " << getFrames()
+            << ",\n  \"window\": " << std::min<uint64_t>(getFrames(), capacity)
+            << ",\n  \"fps\": " << getFps()
+            << ",\n  \"phases\": {";
+        for (uint32_t phase = 0; phase <= PHASE_COUNT; phase++) {
+            out << (phase ? ",\n" : "\n") << "    \"" << getPhaseName(phase) << "\": ";
+            writePercentiles(out, getPercentiles(phase));
+        }
+        percentiles imbalance = getImbalancePercentiles();
+        out << "\n  },\n  \"imbalance\": {\"p50\": " << imbalance.p50 / 1000.0 << ", \"p95\": " << imbalance.p95 / 1000.0
+            << ", \"p99\": " << imbalance.p99 / 1000.0 << ", \"max\": " << imbalance.max / 1000.0 << "}";
+        out << ",\n  \"workers\": [";
+        for (uint32_t i = 0; i < nr_of_workers; i++) {
+            out << (i ? ",\n" : "\n") << "    ";
+            writePercentiles(out, getWorkerPercentiles(i));
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    bool FrameProfiler::dumpJson(const char * path) {
+        std::ofstream out(path);
+        if (!out) {
+            std::clog << "cannot write the frame profile to " << path << std::endl;
+            return false;
+        }
+        writeJson(out);
+        std::clog << "frame profile of " << getFrames() << " frames written to " << path << std::endl;
+        return true;
+    }
+
+    bool FpsMeter::update(int64_t now_ns) {
+        if (updated_at < 0) {
+            // the first call starts the first interval
+            updated_at = now_ns;
+            frames_at_update = frames;
+            return false;
+        }
+        if (now_ns - updated_at < interval_ns) {
+            return false;
+        }
+        fps = (frames - frames_at_update) * 1e9 / (now_ns - updated_at);
+        frames_at_update = frames;
+        updated_at = now_ns;
+        return true;
+    }
+}
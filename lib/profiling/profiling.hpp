@@ -0,0 +1,134 @@
+#if !defined(PROFILING_H)
+#define PROFILING_H
+
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <ostream>
+
+namespace szilv {
+
+    // the parts of a frame on the render thread, in the order of the loop
+    enum FramePhase {
+        PHASE_INPUT,        // events, mouse
+        PHASE_GEOMETRY,     // moving the triangles, building the work
+        PHASE_RASTER,       // submitting the slices, drawing on the render thread
+        PHASE_SYNC_WAIT,    // waiting for the workers to finish the frame
+        PHASE_PRESENT,      // copy, present, page flip, pacing
+        PHASE_COUNT
+    };
+
+    const uint32_t PROFILER_MAX_WORKERS = 64;
+
+    typedef struct frame_record frame_record;
+    struct frame_record {
+        uint64_t frame;
+        int64_t start_ns;
+        int64_t total_ns;
+        int64_t phase_ns[PHASE_COUNT];
+        // the busiest worker over the mean of the workers that drew anything, 1000: even
+        int64_t imbalance_permille;
+    };
+
+    typedef struct percentiles percentiles;
+    struct percentiles {
+        int64_t p50;
+        int64_t p95;
+        int64_t p99;
+        int64_t max;
+    };
+
+    // Records the phase timings of the last frames into a ring buffer, the oldest frames are overwritten.
+    // The phases are switched on the render thread; the workers add their rasterization time with
+    // addWorkerTime, lock-free, into the slot of the current frame. Every frame has to be finished by
+    // the workers before endFrame, which is what ThreadPool::wait guarantees. A loop whose tasks run
+    // across endFrame creates the profiler with 0 workers, it records the phases only.
+    // The JSON report (p50/p95/p99/max per phase and per worker) is written on the render thread: at
+    // endFrame after a SIGUSR1, or by calling writeJson/dumpJson.
+    class FrameProfiler {
+        public:
+            // capacity: the number of frames the percentiles are computed over
+            FrameProfiler(uint32_t nr_of_workers, uint32_t capacity = 4096);
+
+            virtual void beginFrame();
+            // the time since the previous switch goes to the phase before, from now on to phase
+            virtual void phase(FramePhase phase);
+            virtual void endFrame();
+            // any thread, worker_id < nr_of_workers
+            virtual void addWorkerTime(uint32_t worker_id, int64_t ns);
+
+            uint64_t getFrames() { return head.load(std::memory_order_relaxed); }
+            // over the frames in the ring; phase PHASE_COUNT is the whole frame
+            virtual percentiles getPercentiles(uint32_t phase);
+            virtual percentiles getWorkerPercentiles(uint32_t worker_id);
+            // in permille, see frame_record
+            virtual percentiles getImbalancePercentiles();
+            double getLastImbalance() { return last_imbalance; }
+            virtual double getFps();
+
+            virtual void writeJson(std::ostream & out);
+            virtual bool dumpJson(const char * path);
+
+            // SIGUSR1 makes the next endFrame dump to path
+            static void installSignalHandler();
+            void setDumpPath(const char * path) { dump_path = path; }
+
+            static int64_t nowNanos();
+            static const char * getPhaseName(uint32_t phase);
+
+        private:
+            uint32_t nr_of_workers;
+            uint32_t capacity;
+            std::vector<frame_record> records;
+            // capacity x nr_of_workers, the workers add to the row of the current frame
+            std::vector<std::atomic<int64_t>> worker_ns;
+            // frames finished so far, the current frame goes to slot head % capacity
+            std::atomic<uint64_t> head;
+            frame_record current;
+            FramePhase current_phase = PHASE_INPUT;
+            int64_t phase_start_ns = 0;
+            std::string dump_path = "frame_profile.json";
+            double last_imbalance = 1;
+
+            static percentiles computePercentiles(std::vector<int64_t> & values);
+    };
+
+    // Frames per second over the last interval, the one fps measurement of the binaries:
+    // frame() after every frame, update(now) whenever the value is needed.
+    class FpsMeter {
+        public:
+            FpsMeter(int64_t interval_ns = 1000000000) : interval_ns(interval_ns) {}
+
+            void frame() { frames++; }
+            // true when an interval has passed since the last update and the rate got recomputed
+            virtual bool update(int64_t now_ns);
+            double getFps() { return fps; }
+
+        private:
+            int64_t interval_ns;
+            uint64_t frames = 0;
+            uint64_t frames_at_update = 0;
+            int64_t updated_at = -1;
+            double fps = 0;
+    };
+
+    // adds the time of its scope to a worker of a profiler, nothing if the profiler is nullptr
+    class WorkerTimer {
+        public:
+            WorkerTimer(FrameProfiler * profiler, uint32_t worker_id)
+                : profiler(profiler), worker_id(worker_id), start_ns(profiler ? FrameProfiler::nowNanos() : 0) {}
+            ~WorkerTimer() {
+                if (profiler) {
+                    profiler->addWorkerTime(worker_id, FrameProfiler::nowNanos() - start_ns);
+                }
+            }
+
+        private:
+            FrameProfiler * profiler;
+            uint32_t worker_id;
+            int64_t start_ns;
+    };
+}
+
+#endif /* !defined(PROFILING_H) */
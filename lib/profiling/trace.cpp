@@ -0,0 +1,126 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "trace.hpp"
+
+namespace szilv {
+
+    typedef struct trace_thread trace_thread;
+    struct trace_thread {
+        uint32_t tid;
+        std::string name;
+        std::vector<trace_event> events;
+        uint64_t dropped = 0;
+    };
+
+    static std::atomic<bool> trace_enabled(false);
+    static std::atomic<int64_t> trace_start_ns(0);
+    // every thread that ever recorded, never freed: the threads may end before the dump
+    static std::mutex trace_mtx;
+    static std::vector<trace_thread *> trace_threads;
+    static thread_local trace_thread * tl_trace = nullptr;
+
+    static trace_thread * this_thread_buffer() {
+        if (!tl_trace) {
+            std::lock_guard<std::mutex> lock(trace_mtx);
+            tl_trace = new trace_thread();
+            tl_trace->tid = trace_threads.size();
+            tl_trace->events.reserve(4096);
+            trace_threads.push_back(tl_trace);
+        }
+        return tl_trace;
+    }
+
+    static void append(const trace_event & event) {
+        trace_thread * thread = this_thread_buffer();
+        if (thread->events.size() >= TRACE_MAX_EVENTS_PER_THREAD) {
+            thread->dropped++;
+            return;
+        }
+        thread->events.push_back(event);
+    }
+
+    int64_t Trace::nowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void Trace::start() {
+        trace_start_ns.store(nowNanos(), std::memory_order_relaxed);
+        trace_enabled.store(true, std::memory_order_release);
+    }
+
+    bool Trace::isEnabled() {
+        return trace_enabled.load(std::memory_order_relaxed);
+    }
+
+    void Trace::complete(const char * name, const char * category, int64_t start_ns, int64_t end_ns,
+            const char * arg_name, int64_t arg) {
+        if (!isEnabled()) {
+            return;
+        }
+        append({ name, category, start_ns, end_ns - start_ns, arg_name, arg });
+    }
+
+    void Trace::instant(const char * name, const char * category, const char * arg_name, int64_t arg) {
+        if (!isEnabled()) {
+            return;
+        }
+        append({ name, category, nowNanos(), -1, arg_name, arg });
+    }
+
+    void Trace::setThreadName(const char * name) {
+        this_thread_buffer()->name = name;
+    }
+
+    /**
+     * the timestamps are microseconds since start()
+     */
+    void Trace::writeJson(std::ostream & out) {
+        std::lock_guard<std::mutex> lock(trace_mtx);
+        int64_t origin = trace_start_ns.load(std::memory_order_relaxed);
+        bool first = true;
+        out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+        for (auto thread : trace_threads) {
+            out << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+                << thread->tid << ", \"args\": {\"name\": \""
+                << (thread->name.empty() ? "thread " + std::to_string(thread->tid) : thread->name) << "\"}}";
+            first = false;
+            for (auto & e : thread->events) {
+                out << ",\n{\"name\": \"" << e.name << "\", \"cat\": \"" << e.category
+                    << "\", \"pid\": 1, \"tid\": " << thread->tid
+                    << ", \"ts\": " << (e.start_ns - origin) / 1000.0;
+                if (e.duration_ns < 0) {
+                    out << ", \"ph\": \"i\", \"s\": \"t\"";
+                } else {
+                    out << ", \"ph\": \"X\", \"dur\": " << e.duration_ns / 1000.0;
+                }
+                if (e.arg_name) {
+                    out << ", \"args\": {\"" << e.arg_name << "\": " << e.arg << "}";
+                }
+                out << "}";
+            }
+            if (thread->dropped) {
+                std::clog << "trace: thread " << thread->tid << " dropped " << thread->dropped << " events" << std::endl;
+            }
+        }
+        out << "\n]}\n";
+    }
+
+    bool Trace::dumpJson(const char * path) {
+        std::ofstream out(path);
+        if (!out) {
+            std::clog << "cannot write the trace to " << path << std::endl;
+            return false;
+        }
+        out.precision(15);
+        writeJson(out);
+        std::clog << "trace written to " << path << std::endl;
+        return true;
+    }
+}
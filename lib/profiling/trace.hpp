@@ -0,0 +1,64 @@
+#if !defined(TRACE_H)
+#define TRACE_H
+
+#include <cstdint>
+#include <ostream>
+
+namespace szilv {
+
+    // events a thread keeps at most, the rest are dropped and counted
+    const uint32_t TRACE_MAX_EVENTS_PER_THREAD = 1 << 20;
+
+    typedef struct trace_event trace_event;
+    struct trace_event {
+        const char * name;      // static strings only, they are written out at the end
+        const char * category;
+        int64_t start_ns;
+        int64_t duration_ns;    // -1: an instant event
+        const char * arg_name;  // nullptr: no argument
+        int64_t arg;
+    };
+
+    // Opt-in timeline of the begin/end of the slices, tasks and flips, written as a Chrome trace-event
+    // JSON (chrome://tracing, ui.perfetto.dev). Every thread appends to its own buffer, no locks after
+    // the first event of a thread. The JSON has to be written when the recording threads are idle,
+    // e.g. between two frames or at exit.
+    class Trace {
+        public:
+            static void start();
+            static bool isEnabled();
+
+            static void complete(const char * name, const char * category, int64_t start_ns, int64_t end_ns,
+                    const char * arg_name = nullptr, int64_t arg = 0);
+            static void instant(const char * name, const char * category,
+                    const char * arg_name = nullptr, int64_t arg = 0);
+            // shown instead of "thread <n>" on the timeline
+            static void setThreadName(const char * name);
+
+            static void writeJson(std::ostream & out);
+            static bool dumpJson(const char * path);
+            static int64_t nowNanos();
+    };
+
+    // a complete event of its scope, nothing when tracing is off
+    class TraceScope {
+        public:
+            TraceScope(const char * name, const char * category, const char * arg_name = nullptr, int64_t arg = 0)
+                : name(name), category(category), arg_name(arg_name), arg(arg),
+                start_ns(Trace::isEnabled() ? Trace::nowNanos() : -1) {}
+            ~TraceScope() {
+                if (start_ns >= 0) {
+                    Trace::complete(name, category, start_ns, Trace::nowNanos(), arg_name, arg);
+                }
+            }
+
+        private:
+            const char * name;
+            const char * category;
+            const char * arg_name;
+            int64_t arg;
+            int64_t start_ns;
+    };
+}
+
+#endif /* !defined(TRACE_H) */
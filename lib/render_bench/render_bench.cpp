@@ -0,0 +1,562 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <thread>
+#include <semaphore>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <functional>
+#include <algorithm>
+
+#if defined(RENDER_BENCH_TBB)
+#include <oneapi/tbb.h>
+#endif
+
+#include "offscreen.hpp"
+#include "base_geometry.hpp"
+#include "2D_triangle.hpp"
+#include "2D_rasterizer.hpp"
+#include "2D_triangle_simd.hpp"
+#include "2D_line_drawer.hpp"
+#include "thread_pool.hpp"
+#include "tools.hpp"
+
+/**
+ * Renders the same centered triangle into identical offscreen buffers with every render strategy of
+ * the repository and reports the cost per frame and per pixel.
+ *
+ *   single            one thread, pointInTriangle for every pixel (framebuffer/draw_triangle_in_framebuffer)
+ *   semaphore         LineDrawer2D workers, one blocking handoff per slice (lib/2D_line_drawer)
+ *   binary_semaphore  std::binary_semaphore workers (framebuffer/draw_triangle_in_framebuffer_threads2)
+ *   work_stealing     ThreadPool, the frame is submitted at once and waited for once (lib/thread_pool)
+ *   tbb               parallel_for over blocked_range2d with static_partitioner (sdl_framebuffer_threadpool_triangle)
+ *   simd              one thread, AVX2/SSE4.1 per pixel coverage (lib/2D_triangle_simd)
+ *
+ * The threaded strategies draw with the per pixel kernel or with the span rasterizer (kernel column),
+ * so the engines are compared on the same work. Every result is checked against the single threaded
+ * per pixel frame.
+ *
+ * Flags follow Google Benchmark:
+ *   --benchmark_filter=<substring>     run only the cases whose name contains it
+ *   --benchmark_min_time=<seconds>     minimum measured time per case, default 0.2
+ *   --benchmark_format=console|csv|json
+ *   --benchmark_out=<file>             write the results there too, in --benchmark_out_format
+ *   --benchmark_out_format=csv|json    default json
+ *   --resolutions=720p,1080p,1440p,4k,8k
+ *   --triangles=small,medium,large     triangle side 10%, 50%, 95% of the buffer height
+ *   --threads=1,2,4,...                default powers of two up to the number of CPUs
+ */
+
+namespace bench {
+
+    const uint32_t color = 0xFFFFFF;
+    const uint32_t bg_color = 0x0;
+    const uint32_t buffer_slice = 10;
+
+    typedef struct {
+        std::string name;
+        uint32_t width;
+        uint32_t height;
+    } Resolution;
+
+    typedef struct {
+        std::string name;
+        double side; // relative to the buffer height
+    } TriangleSize;
+
+    typedef struct {
+        std::string name;
+        std::string strategy;
+        std::string kernel;
+        std::string resolution;
+        uint32_t width;
+        uint32_t height;
+        std::string triangle;
+        uint32_t threads;
+        uint64_t iterations;
+        double ns_per_frame;
+        double ns_per_pixel;
+        double fps;
+        bool correct;
+    } Result;
+
+    // The scene of one case: the buffer, the triangle and the square the strategies split into slices
+    typedef struct {
+        szilv::offscreen_buf * buf;
+        szilv::Triangle2D * triangle;
+        szilv::Rasterizer2D * rasterizer;
+        szilv::TriangleFillSimd2D * simd_fill;
+        szilv::SquareDefinition square;
+        bool spans;
+    } Scene;
+
+    static szilv::DrawWork makeWork(const Scene & s, szilv::SquareDefinition square) {
+        szilv::DrawWork work = {
+            color, bg_color,
+            (void*)s.triangle, szilv::SHAPE_TRIANGLE,
+            square, (uint8_t*)s.buf->map,
+            s.buf->stride, s.buf->width, s.buf->height,
+            s.spans ? s.rasterizer : nullptr
+        };
+        return work;
+    }
+
+    static std::vector<szilv::SquareDefinition> slices(const szilv::SquareDefinition & square) {
+        std::vector<szilv::SquareDefinition> result;
+        for (int32_t y = square.y1; y <= square.y2; y += buffer_slice) {
+            result.push_back({ square.x1, y, square.x2, std::min(y + (int32_t)buffer_slice - 1, square.y2) });
+        }
+        return result;
+    }
+
+    // One strategy: set up once per case, then draw one frame per call
+    class Strategy {
+        public:
+            virtual ~Strategy() {}
+            virtual void drawFrame(const Scene & s) = 0;
+    };
+
+    class SingleThread : public Strategy {
+        public:
+            void drawFrame(const Scene & s) override {
+                if (s.spans) {
+                    s.rasterizer->fillRows((uint8_t*)s.buf->map, s.buf->stride, s.square, color, bg_color);
+                    return;
+                }
+                for (int32_t y = s.square.y1; y <= s.square.y2; y++) {
+                    uint32_t * row = reinterpret_cast<uint32_t*>((uint8_t*)s.buf->map + y * s.buf->stride);
+                    for (int32_t x = s.square.x1; x <= s.square.x2; x++) {
+                        szilv::Vertex point = {(double)x, (double)y, 0.0};
+                        row[x] = s.triangle->pointInTriangle(point) ? color : bg_color;
+                    }
+                }
+            }
+    };
+
+    class SimdSingleThread : public Strategy {
+        public:
+            void drawFrame(const Scene & s) override {
+                s.simd_fill->fillRows((uint8_t*)s.buf->map, s.buf->stride, s.square, color, bg_color);
+            }
+    };
+
+    class SemaphoreWorkers : public Strategy {
+        public:
+            SemaphoreWorkers(uint32_t nr_of_workers) {
+                for (uint32_t i = 0; i < nr_of_workers; i++) {
+                    workers.push_back(new szilv::LineDrawer2D(i, 0, 0));
+                }
+            }
+            ~SemaphoreWorkers() {
+                while (workers.size()) {
+                    delete workers.back();
+                    workers.pop_back();
+                }
+            }
+            void drawFrame(const Scene & s) override {
+                uint32_t slice = 0;
+                for (auto & square : slices(s.square)) {
+                    workers[slice++ % workers.size()]->addWorkBlocking(makeWork(s, square));
+                }
+                for (auto worker : workers) {
+                    worker->blockMainThreadUntilTheQueueIsNotEmpty();
+                }
+            }
+
+        private:
+            std::vector<szilv::LineDrawer2D *> workers;
+    };
+
+    // the handoff of the LineDrawer in draw_triangle_in_framebuffer_threads2, drawing with LineDrawer2D::drawWork
+    class BinarySemaphoreWorker {
+        public:
+            BinarySemaphoreWorker() {
+                thd = std::thread([this] { threadWorker(); });
+            }
+            ~BinarySemaphoreWorker() {
+                keep_running = false;
+                // the worker waits only here between frames, releasing the other two could exceed their max of 1
+                sem_block_this_thread.release();
+                thd.join();
+            }
+            void addWorkBlocking(szilv::DrawWork work) {
+                sem_work_queue.acquire();
+                work_queue.push(work);
+                sem_work_queue.release();
+                sem_block_this_thread.release();
+                sem_block_main_thread.acquire();
+            }
+            void blockMainThreadUntilTheQueueIsNotEmpty() {
+                sem_block_main_thread.acquire();
+                sem_block_main_thread.release();
+            }
+
+        private:
+            bool keep_running = true;
+            std::binary_semaphore sem_work_queue{1};
+            std::queue<szilv::DrawWork> work_queue;
+            std::thread thd;
+            std::binary_semaphore sem_block_this_thread{0};
+            std::binary_semaphore sem_block_main_thread{1};
+
+            void threadWorker() {
+                while (keep_running) {
+                    sem_block_this_thread.acquire();
+                    sem_work_queue.acquire();
+                    while (!work_queue.empty()) {
+                        szilv::LineDrawer2D::drawWork(work_queue.front());
+                        work_queue.pop();
+                    }
+                    sem_work_queue.release();
+                    sem_block_main_thread.release();
+                }
+            }
+    };
+
+    class BinarySemaphoreWorkers : public Strategy {
+        public:
+            BinarySemaphoreWorkers(uint32_t nr_of_workers) {
+                for (uint32_t i = 0; i < nr_of_workers; i++) {
+                    workers.push_back(new BinarySemaphoreWorker());
+                }
+            }
+            ~BinarySemaphoreWorkers() {
+                while (workers.size()) {
+                    delete workers.back();
+                    workers.pop_back();
+                }
+            }
+            void drawFrame(const Scene & s) override {
+                uint32_t slice = 0;
+                for (auto & square : slices(s.square)) {
+                    workers[slice++ % workers.size()]->addWorkBlocking(makeWork(s, square));
+                }
+                for (auto worker : workers) {
+                    worker->blockMainThreadUntilTheQueueIsNotEmpty();
+                }
+            }
+
+        private:
+            std::vector<BinarySemaphoreWorker *> workers;
+    };
+
+    class WorkStealing : public Strategy {
+        public:
+            WorkStealing(uint32_t nr_of_workers) : pool(nr_of_workers) {}
+            void drawFrame(const Scene & s) override {
+                for (auto & square : slices(s.square)) {
+                    tasks.emplace_back(makeWork(s, square));
+                    pool.submit(&tasks.back());
+                }
+                pool.wait();
+                tasks.clear();
+            }
+
+        private:
+            szilv::ThreadPool pool;
+            std::deque<szilv::DrawTask> tasks;
+    };
+
+#if defined(RENDER_BENCH_TBB)
+    class Tbb : public Strategy {
+        public:
+            Tbb(uint32_t nr_of_workers) : arena(nr_of_workers) {}
+            void drawFrame(const Scene & s) override {
+                arena.execute([&]() {
+                    // half open ranges, unlike the inclusive SquareDefinition
+                    auto range = oneapi::tbb::blocked_range2d<int>(s.square.y1, s.square.y2 + 1, s.square.x1, s.square.x2 + 1);
+                    oneapi::tbb::parallel_for(
+                            range,
+                            [&](const oneapi::tbb::blocked_range2d<int>& r) {
+                                szilv::SquareDefinition square = {
+                                    r.cols().begin(), r.rows().begin(), r.cols().end() - 1, r.rows().end() - 1
+                                };
+                                szilv::LineDrawer2D::drawWork(makeWork(s, square));
+                            },
+                            partitioner
+                    );
+                });
+            }
+
+        private:
+            oneapi::tbb::task_arena arena;
+            oneapi::tbb::static_partitioner partitioner;
+    };
+#endif
+
+    static std::vector<std::string> split(const std::string & list) {
+        std::vector<std::string> result;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            if (!item.empty()) {
+                result.push_back(item);
+            }
+        }
+        return result;
+    }
+
+    static std::string csvHeader() {
+        return "name,strategy,kernel,resolution,width,height,triangle,threads,iterations,ns_per_frame,ns_per_pixel,fps,correct";
+    }
+
+    static std::string toCsv(const Result & r) {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3);
+        os << r.name << "," << r.strategy << "," << r.kernel << "," << r.resolution << "," << r.width << ","
+            << r.height << "," << r.triangle << "," << r.threads << "," << r.iterations << "," << r.ns_per_frame
+            << "," << r.ns_per_pixel << "," << r.fps << "," << (r.correct ? "true" : "false");
+        return os.str();
+    }
+
+    static std::string toJson(const std::vector<Result> & results) {
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3);
+        os << "{\n  \"context\": {\n"
+            << "    \"num_cpus\": " << tl::Tools::nr_of_cpus() << ",\n"
+            << "    \"simd_path\": \"" << szilv::TriangleFillSimd2D::getPathName() << "\"\n"
+            << "  },\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result & r = results[i];
+            os << (i ? "," : "") << "\n    {"
+                << "\"name\": \"" << r.name << "\", "
+                << "\"strategy\": \"" << r.strategy << "\", "
+                << "\"kernel\": \"" << r.kernel << "\", "
+                << "\"resolution\": \"" << r.resolution << "\", "
+                << "\"width\": " << r.width << ", "
+                << "\"height\": " << r.height << ", "
+                << "\"triangle\": \"" << r.triangle << "\", "
+                << "\"threads\": " << r.threads << ", "
+                << "\"iterations\": " << r.iterations << ", "
+                << "\"ns_per_frame\": " << r.ns_per_frame << ", "
+                << "\"ns_per_pixel\": " << r.ns_per_pixel << ", "
+                << "\"fps\": " << r.fps << ", "
+                << "\"correct\": " << (r.correct ? "true" : "false") << "}";
+        }
+        os << "\n  ]\n}\n";
+        return os.str();
+    }
+
+    /**
+     * Doubles the number of iterations until the measured time reaches min_time, like Google Benchmark
+     */
+    static void run(Strategy & strategy, const Scene & scene, double min_time, Result & r) {
+        strategy.drawFrame(scene); // warm up
+        uint64_t iterations = 1;
+        while (true) {
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; i++) {
+                strategy.drawFrame(scene);
+            }
+            double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            if (elapsed >= min_time * 1e9 || iterations >= (1ULL << 30)) {
+                uint64_t pixels = (uint64_t)(scene.square.x2 - scene.square.x1 + 1) * (scene.square.y2 - scene.square.y1 + 1);
+                r.iterations = iterations;
+                r.ns_per_frame = elapsed / iterations;
+                r.ns_per_pixel = r.ns_per_frame / pixels;
+                r.fps = 1e9 / r.ns_per_frame;
+                return;
+            }
+            iterations *= 2;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    using namespace bench;
+
+    std::string filter;
+    double min_time = 0.2;
+    std::string format = "console";
+    std::string out_file;
+    std::string out_format = "json";
+    std::vector<std::string> resolution_names = { "720p", "1080p", "1440p", "4k", "8k" };
+    std::vector<std::string> triangle_names = { "small", "medium", "large" };
+    std::vector<uint32_t> thread_counts;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--benchmark_filter") {
+            filter = value;
+        } else if (key == "--benchmark_min_time") {
+            min_time = std::stod(value);
+        } else if (key == "--benchmark_format") {
+            format = value;
+        } else if (key == "--benchmark_out") {
+            out_file = value;
+        } else if (key == "--benchmark_out_format") {
+            out_format = value;
+        } else if (key == "--resolutions") {
+            resolution_names = split(value);
+        } else if (key == "--triangles") {
+            triangle_names = split(value);
+        } else if (key == "--threads") {
+            for (auto & t : split(value)) {
+                thread_counts.push_back(std::max(1, std::stoi(t)));
+            }
+        } else {
+            std::cerr << "unknown argument " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (thread_counts.empty()) {
+        for (uint32_t t = 1; t < tl::Tools::nr_of_cpus(); t *= 2) {
+            thread_counts.push_back(t);
+        }
+        thread_counts.push_back(std::max(1U, tl::Tools::nr_of_cpus()));
+    }
+
+    const std::vector<Resolution> all_resolutions = {
+        { "720p", 1280, 720 }, { "1080p", 1920, 1080 }, { "1440p", 2560, 1440 },
+        { "4k", 3840, 2160 }, { "8k", 7680, 4320 }
+    };
+    const std::vector<TriangleSize> all_triangles = { { "small", 0.1 }, { "medium", 0.5 }, { "large", 0.95 } };
+
+    std::vector<std::string> strategies = { "single", "simd", "semaphore", "binary_semaphore", "work_stealing" };
+#if defined(RENDER_BENCH_TBB)
+    strategies.push_back("tbb");
+#endif
+
+    std::vector<Result> results;
+    if (format == "csv") {
+        std::cout << csvHeader() << std::endl;
+    }
+
+    for (auto & res_name : resolution_names) {
+        auto res = std::find_if(all_resolutions.begin(), all_resolutions.end(),
+                [&](const Resolution & r) { return r.name == res_name; });
+        if (res == all_resolutions.end()) {
+            std::cerr << "unknown resolution " << res_name << std::endl;
+            return -1;
+        }
+        szilv::OffscreenTarget offscreen(res->width, res->height);
+        if (offscreen.initDev()) {
+            return -1;
+        }
+        szilv::offscreen_buf * buf = &offscreen.mdev->bufs[0];
+        szilv::offscreen_buf * reference = &offscreen.mdev->bufs[1];
+
+        for (auto & tri_name : triangle_names) {
+            auto tri = std::find_if(all_triangles.begin(), all_triangles.end(),
+                    [&](const TriangleSize & t) { return t.name == tri_name; });
+            if (tri == all_triangles.end()) {
+                std::cerr << "unknown triangle size " << tri_name << std::endl;
+                return -1;
+            }
+
+            // an equilateral triangle in the middle of the buffer, slightly rotated so no edge is axis aligned
+            double side = tri->side * res->height;
+            double height = side * sin(60 * M_PI / 180);
+            szilv::Triangle2D triangle({ side / 2, 0, 0 }, { 0, height, 0 }, { side, height, 0 });
+            triangle.translateToNewCenter({ res->width / 2.0, res->height / 2.0, 0 });
+            triangle.rotateAroundTheCenter(0.1);
+            szilv::Rasterizer2D rasterizer(triangle.getPrimitive());
+            szilv::TriangleFillSimd2D simd_fill;
+            simd_fill.setPrimitive(triangle.getPrimitive());
+            auto p = triangle.getPrimitive();
+            Scene scene = {
+                reference, &triangle, &rasterizer, &simd_fill,
+                {
+                    std::max(0, (int32_t)std::min({p.p1.x, p.p2.x, p.p3.x})),
+                    std::max(0, (int32_t)std::min({p.p1.y, p.p2.y, p.p3.y})),
+                    std::min((int32_t)res->width - 1, (int32_t)std::max({p.p1.x, p.p2.x, p.p3.x})),
+                    std::min((int32_t)res->height - 1, (int32_t)std::max({p.p1.y, p.p2.y, p.p3.y}))
+                },
+                false
+            };
+            // every case starts from the same garbage, pixels a strategy misses do not match the reference
+            std::memset(reference->map, 0x55, reference->size);
+            SingleThread().drawFrame(scene);
+            scene.buf = buf;
+
+            for (auto & strategy_name : strategies) {
+                bool threaded = strategy_name != "single" && strategy_name != "simd";
+                for (auto kernel : { "pixel", "span" }) {
+                    if (strategy_name == "simd" && std::string(kernel) == "span") {
+                        continue;
+                    }
+                    for (uint32_t threads : thread_counts) {
+                        if (!threaded && threads != thread_counts.front()) {
+                            continue;
+                        }
+                        Result r;
+                        r.strategy = strategy_name;
+                        r.kernel = strategy_name == "simd" ? szilv::TriangleFillSimd2D::getPathName() : kernel;
+                        r.resolution = res->name;
+                        r.width = res->width;
+                        r.height = res->height;
+                        r.triangle = tri->name;
+                        r.threads = threaded ? threads : 1;
+                        r.name = "BM_" + r.strategy + "/" + r.kernel + "/" + r.resolution + "/" + r.triangle
+                            + "/threads:" + std::to_string(r.threads);
+                        if (!filter.empty() && r.name.find(filter) == std::string::npos) {
+                            continue;
+                        }
+                        scene.spans = std::string(kernel) == "span";
+                        std::memset(buf->map, 0x55, buf->size);
+
+                        Strategy * strategy = nullptr;
+                        if (strategy_name == "single") {
+                            strategy = new SingleThread();
+                        } else if (strategy_name == "simd") {
+                            strategy = new SimdSingleThread();
+                        } else if (strategy_name == "semaphore") {
+                            strategy = new SemaphoreWorkers(threads);
+                        } else if (strategy_name == "binary_semaphore") {
+                            strategy = new BinarySemaphoreWorkers(threads);
+                        } else if (strategy_name == "work_stealing") {
+                            // the waiting main thread draws too, so one less worker for the same parallelism
+                            strategy = new WorkStealing(threads - 1);
+#if defined(RENDER_BENCH_TBB)
+                        } else if (strategy_name == "tbb") {
+                            strategy = new Tbb(threads);
+#endif
+                        }
+                        run(*strategy, scene, min_time, r);
+                        delete strategy;
+
+                        r.correct = szilv::OffscreenTarget::checksum(buf) == szilv::OffscreenTarget::checksum(reference);
+                        results.push_back(r);
+
+                        if (format == "csv") {
+                            std::cout << toCsv(r) << std::endl;
+                        } else if (format == "console") {
+                            std::cout << std::left << std::setw(56) << r.name << std::right << std::fixed
+                                << std::setprecision(1) << std::setw(14) << r.ns_per_frame << " ns"
+                                << std::setprecision(3) << std::setw(10) << r.ns_per_pixel << " ns/pixel"
+                                << std::setw(10) << r.iterations
+                                << (r.correct ? "" : "  WRONG OUTPUT") << std::endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (format == "json") {
+        std::cout << toJson(results);
+    }
+    if (!out_file.empty()) {
+        std::ofstream out(out_file);
+        if (out_format == "csv") {
+            out << csvHeader() << "\n";
+            for (auto & r : results) {
+                out << toCsv(r) << "\n";
+            }
+        } else {
+            out << toJson(results);
+        }
+    }
+
+    bool all_correct = std::all_of(results.begin(), results.end(), [](const Result & r) { return r.correct; });
+    return all_correct ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#include "shadow_buffer.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SHADOW_BUFFER_STREAM
+#endif
+
+namespace szilv {
+
+    const uint32_t SHADOW_ALIGNMENT = 64;
+
+    ShadowBuffer::ShadowBuffer(uint32_t width, uint32_t height, uint32_t stride, uint32_t nr_of_targets) {
+        this->width = width;
+        this->height = height;
+        this->stride = stride;
+        this->size = stride * height;
+        this->map = nullptr;
+        dirty.resize(nr_of_targets);
+    }
+
+    ShadowBuffer::~ShadowBuffer() {
+        free(map);
+        std::clog << "ShadowBuffer destroyed, " << copied_bytes / (1024 * 1024) << " MiB copied" << std::endl;
+    }
+
+    /**
+     * Allocates the buffer. Returns 0 or a negative errno like DrmUtil::initDrmDev
+     */
+    int32_t ShadowBuffer::init() {
+        if (!width || !height || stride < width * sizeof(uint32_t)) {
+            std::cerr << "invalid shadow buffer " << width << "x" << height << ", stride " << stride << std::endl;
+            return -EINVAL;
+        }
+        void * mem = nullptr;
+        if (posix_memalign(&mem, SHADOW_ALIGNMENT, size)) {
+            std::cerr << "cannot allocate shadow buffer: " << strerror(ENOMEM) << std::endl;
+            return -ENOMEM;
+        }
+        memset(mem, 0, size);
+        map = (int32_t *)mem;
+
+        // the targets hold whatever was there before, the first flush copies everything
+        for (auto & rects : dirty) {
+            rects.clear();
+            rects.push_back({ 0, 0, (int32_t)width - 1, (int32_t)height - 1 });
+        }
+        std::clog << "shadow buffer " << width << "x" << height << " for " << dirty.size() << " targets"
+#if defined(SHADOW_BUFFER_STREAM)
+            << ", streaming copy"
+#endif
+            << std::endl;
+        return 0;
+    }
+
+    void ShadowBuffer::addDirty(SquareDefinition rect) {
+        rect.x1 = std::max(rect.x1, 0);
+        rect.y1 = std::max(rect.y1, 0);
+        rect.x2 = std::min(rect.x2, (int32_t)width - 1);
+        rect.y2 = std::min(rect.y2, (int32_t)height - 1);
+        if (rect.x1 > rect.x2 || rect.y1 > rect.y2) {
+            return;
+        }
+        for (auto & rects : dirty) {
+            addRect(rects, rect);
+        }
+    }
+
+    /**
+     * Keeps the list free of overlaps, so no pixel is copied twice: a rectangle that overlaps or touches
+     * another one is merged into it, and the result is merged again until nothing overlaps
+     */
+    void ShadowBuffer::addRect(std::vector<SquareDefinition> & rects, SquareDefinition rect) {
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            for (size_t i = 0; i < rects.size(); i++) {
+                SquareDefinition & r = rects[i];
+                if (rect.x1 <= r.x2 + 1 && r.x1 <= rect.x2 + 1 && rect.y1 <= r.y2 + 1 && r.y1 <= rect.y2 + 1) {
+                    rect = { std::min(rect.x1, r.x1), std::min(rect.y1, r.y1),
+                        std::max(rect.x2, r.x2), std::max(rect.y2, r.y2) };
+                    rects.erase(rects.begin() + i);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+        if (rects.size() >= SHADOW_MAX_DIRTY_RECTS) {
+            for (auto & r : rects) {
+                rect = { std::min(rect.x1, r.x1), std::min(rect.y1, r.y1),
+                    std::max(rect.x2, r.x2), std::max(rect.y2, r.y2) };
+            }
+            rects.clear();
+        }
+        rects.push_back(rect);
+    }
+
+    uint64_t ShadowBuffer::flush(uint32_t target, int32_t * dst, uint32_t dst_stride) {
+        uint64_t bytes = 0;
+        const uint8_t * src = (const uint8_t *)map;
+        for (auto & r : dirty[target]) {
+            uint32_t row_bytes = (r.x2 - r.x1 + 1) * sizeof(uint32_t);
+            for (int32_t y = r.y1; y <= r.y2; y++) {
+                streamCopy((uint8_t *)dst + y * dst_stride + r.x1 * sizeof(uint32_t),
+                        src + y * stride + r.x1 * sizeof(uint32_t), row_bytes);
+            }
+            bytes += (uint64_t)row_bytes * (r.y2 - r.y1 + 1);
+        }
+        dirty[target].clear();
+#if defined(SHADOW_BUFFER_STREAM)
+        // the streaming stores are weakly ordered, they have to land before the buffer goes to the display
+        _mm_sfence();
+#endif
+        copied_bytes += bytes;
+        return bytes;
+    }
+
+    /**
+     * The destination is written in whole 16 byte stores from its first aligned address, the unaligned
+     * head and tail one pixel at a time. The caller fences.
+     */
+    void ShadowBuffer::streamCopy(uint8_t * dst, const uint8_t * src, uint32_t bytes) {
+#if defined(SHADOW_BUFFER_STREAM)
+        while (((uintptr_t)dst & 15) && bytes >= sizeof(uint32_t)) {
+            memcpy(dst, src, sizeof(uint32_t));
+            dst += sizeof(uint32_t);
+            src += sizeof(uint32_t);
+            bytes -= sizeof(uint32_t);
+        }
+        for (; bytes >= 64; bytes -= 64, dst += 64, src += 64) {
+            __m128i a = _mm_loadu_si128((const __m128i *)src);
+            __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+            __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+            __m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+            _mm_stream_si128((__m128i *)dst, a);
+            _mm_stream_si128((__m128i *)(dst + 16), b);
+            _mm_stream_si128((__m128i *)(dst + 32), c);
+            _mm_stream_si128((__m128i *)(dst + 48), d);
+        }
+        for (; bytes >= 16; bytes -= 16, dst += 16, src += 16) {
+            _mm_stream_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+        }
+#endif
+        memcpy(dst, src, bytes);
+    }
+}
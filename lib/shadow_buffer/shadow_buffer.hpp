@@ -0,0 +1,53 @@
+#if !defined(SHADOW_BUFFER_H)
+#define SHADOW_BUFFER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "base_geometry.hpp"
+
+namespace szilv {
+
+    // at most this many separate rectangles per target, beyond it they collapse into their bounding box
+    const uint32_t SHADOW_MAX_DIRTY_RECTS = 16;
+
+    // The frame in normal cacheable memory. The draw code reads and rewrites rows of it, which is slow on
+    // the write-combined/uncached dumb buffer mappings. flush() copies only the rectangles that changed
+    // since the previous flush into the given scanout buffer, with streaming stores that do not pollute
+    // the cache. Every target (swapchain buffer) has its own dirty list, as each one missed a different
+    // number of frames.
+    class ShadowBuffer {
+        public:
+            // stride: bytes per row, the same as the target's so offsets are interchangeable
+            ShadowBuffer(uint32_t width, uint32_t height, uint32_t stride, uint32_t nr_of_targets);
+            ~ShadowBuffer();
+            virtual int32_t init();
+
+            // the render target, XRGB8888 with the layout of modeset_buf::map
+            int32_t * map;
+            uint32_t getWidth() { return width; }
+            uint32_t getHeight() { return height; }
+            uint32_t getStride() { return stride; }
+
+            // marks a rectangle (inclusive coordinates) changed in every target, clamped to the buffer
+            virtual void addDirty(SquareDefinition rect);
+            // copies the dirty rectangles of target into dst and clears its list. Returns the bytes copied
+            virtual uint64_t flush(uint32_t target, int32_t * dst, uint32_t dst_stride);
+            uint64_t getCopiedBytes() { return copied_bytes; }
+
+            // memcpy-like for one row, non-temporal stores where the platform has them
+            static void streamCopy(uint8_t * dst, const uint8_t * src, uint32_t bytes);
+
+        private:
+            uint32_t width;
+            uint32_t height;
+            uint32_t stride;
+            uint32_t size;
+            std::vector<std::vector<SquareDefinition>> dirty;
+            uint64_t copied_bytes = 0;
+
+            virtual void addRect(std::vector<SquareDefinition> & rects, SquareDefinition rect);
+    };
+}
+
+#endif /* !defined(SHADOW_BUFFER_H) */
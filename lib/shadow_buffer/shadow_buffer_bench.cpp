@@ -0,0 +1,137 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include "shadow_buffer.hpp"
+#include "2D_line_drawer.hpp"
+#include "2D_triangle.hpp"
+#include "2D_rasterizer.hpp"
+#if defined(SHADOW_BUFFER_BENCH_DRM)
+#include "drm_util.hpp"
+#endif
+
+/**
+ * Frame time of drawing a rotating triangle straight into the scanout buffer against drawing it into a
+ * ShadowBuffer and flushing the dirty rectangle. Single threaded, the same span fill that only rewrites
+ * the difference to the previous frame as the DRM binaries use.
+ * The scanout buffer is heap memory, or a mapped dumb buffer of the given DRI device when the bench is
+ * built together with DrmUtil; only the latter shows the cost of write-combined memory.
+ *
+ * usage: shadow_buffer_bench [frames] [width] [height] [dri-device]
+ */
+
+const uint32_t color = 0xFFFFFF;
+const uint32_t bg_color = 0x0;
+const uint32_t slice = 10;
+
+static szilv::SquareDefinition squareOf(const szilv::TrianglePrimitive & a, const szilv::TrianglePrimitive & b) {
+    return {
+        (int32_t) std::min({a.p1.x, a.p2.x, a.p3.x, b.p1.x, b.p2.x, b.p3.x}),
+        (int32_t) std::min({a.p1.y, a.p2.y, a.p3.y, b.p1.y, b.p2.y, b.p3.y}),
+        (int32_t) std::max({a.p1.x, a.p2.x, a.p3.x, b.p1.x, b.p2.x, b.p3.x}),
+        (int32_t) std::max({a.p1.y, a.p2.y, a.p3.y, b.p1.y, b.p2.y, b.p3.y}),
+    };
+}
+
+/**
+ * Draws the frames into target and returns ns/frame. With shadow set, target is the shadow's map and
+ * dst gets the flushes.
+ */
+static double run(uint32_t frames, uint32_t width, uint32_t height, uint32_t stride,
+        int32_t * target, szilv::ShadowBuffer * shadow, int32_t * dst) {
+    double side = std::min(width, height) * 0.4;
+    szilv::Triangle2D triangle(
+            { side * 0.5, 0, 0 },
+            { 0, side * 0.866, 0 },
+            { side, side * 0.866, 0 });
+    szilv::Rasterizer2D rasterizer(triangle.getPrimitive());
+    szilv::Rasterizer2D old_rasterizer(triangle.getPrimitive());
+    szilv::TrianglePrimitive old_primitive = triangle.getPrimitive();
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t f = 0; f < frames; f++) {
+        double phase = f * 0.02;
+        triangle.translateToNewCenter({
+                width * (0.5 + 0.25 * std::cos(phase)), height * (0.5 + 0.25 * std::sin(phase)), 0 });
+        triangle.rotateAroundTheCenter(0.01);
+        rasterizer.setPrimitive(triangle.getPrimitive());
+
+        szilv::SquareDefinition square = squareOf(triangle.getPrimitive(), old_primitive);
+        for (int32_t y = square.y1; y <= square.y2; y += slice) {
+            szilv::DrawWork work = {
+                color, bg_color,
+                (void*)&triangle, szilv::SHAPE_TRIANGLE,
+                { square.x1, y, square.x2, std::min(y + (int32_t)slice - 1, square.y2) },
+                (uint8_t*)target, stride, width, height,
+                &rasterizer, &old_rasterizer
+            };
+            szilv::LineDrawer2D::drawWork(work);
+        }
+        if (shadow) {
+            shadow->addDirty(square);
+            shadow->flush(0, dst, stride);
+        }
+        old_primitive = triangle.getPrimitive();
+        old_rasterizer.setPrimitive(old_primitive);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / frames;
+}
+
+int main(int argc, char **argv) {
+    uint32_t frames = argc > 1 ? std::atoi(argv[1]) : 2000;
+    uint32_t width = argc > 2 ? std::atoi(argv[2]) : 1920;
+    uint32_t height = argc > 3 ? std::atoi(argv[3]) : 1080;
+    uint32_t stride = (width * sizeof(uint32_t) + 63) / 64 * 64;
+    int32_t * scanout = nullptr;
+    std::vector<int32_t> heap;
+
+#if defined(SHADOW_BUFFER_BENCH_DRM)
+    szilv::DrmUtil * drmUtil = nullptr;
+    if (argc > 4) {
+        drmUtil = new szilv::DrmUtil(argv[4]);
+        if (drmUtil->initDrmDev()) {
+            return 1;
+        }
+        szilv::modeset_buf * buf = &drmUtil->mdev->bufs[drmUtil->mdev->front_buf];
+        width = buf->width;
+        height = buf->height;
+        stride = buf->stride;
+        scanout = buf->map;
+    }
+#endif
+    if (!scanout) {
+        heap.resize(stride / sizeof(int32_t) * height);
+        scanout = heap.data();
+    }
+
+    memset(scanout, 0, stride * height);
+    double direct = run(frames, width, height, stride, scanout, nullptr, nullptr);
+    std::vector<int32_t> direct_result(scanout, scanout + stride / sizeof(int32_t) * height);
+
+    memset(scanout, 0, stride * height);
+    szilv::ShadowBuffer shadow(width, height, stride, 1);
+    if (shadow.init()) {
+        return 1;
+    }
+    double shadowed = run(frames, width, height, stride, shadow.map, &shadow, scanout);
+    bool same = std::memcmp(direct_result.data(), scanout, stride * height) == 0;
+
+    std::cout << width << "x" << height << ", " << frames << " frames, "
+        << (scanout == heap.data() ? "heap" : "dumb buffer") << " scanout, us/frame" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  direct           " << direct / 1000 << std::endl;
+    std::cout << "  shadow + flush   " << shadowed / 1000 << "  (" << direct / shadowed << "x), "
+        << shadow.getCopiedBytes() / frames / 1024 << " KiB copied per frame" << std::endl;
+    std::cout << "  output " << (same ? "identical" : "DIFFERS") << std::endl;
+
+#if defined(SHADOW_BUFFER_BENCH_DRM)
+    delete drmUtil;
+#endif
+    return same ? 0 : 1;
+}
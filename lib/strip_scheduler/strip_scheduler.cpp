@@ -0,0 +1,73 @@
+#include <algorithm>
+
+#include "strip_scheduler.hpp"
+
+namespace szilv {
+
+    StripScheduler::StripScheduler(uint32_t nr_of_strips, uint32_t min_rows) {
+        this->nr_of_strips = nr_of_strips ? nr_of_strips : 1;
+        this->min_rows = min_rows ? min_rows : 1;
+    }
+
+    uint32_t StripScheduler::split(SquareDefinition square, const Rasterizer2D & current, const Rasterizer2D & old,
+            std::vector<SquareDefinition> & strips) {
+        strips.clear();
+        last_cost = 0;
+        if (square.x2 < square.x1 || square.y2 < square.y1) {
+            return 0;
+        }
+        uint32_t rows = square.y2 - square.y1 + 1;
+        row_cost.resize(rows);
+        row_span.resize(rows);
+
+        // what the diff fill touches on every row: the union of the two spans
+        for (uint32_t i = 0; i < rows; i++) {
+            int32_t y = square.y1 + i;
+            Span s = current.getSpan(y, square.x1, square.x2);
+            Span o = old.getSpan(y, square.x1, square.x2);
+            uint64_t pixels = (s.x1 <= s.x2 ? s.x2 - s.x1 + 1 : 0) + (o.x1 <= o.x2 ? o.x2 - o.x1 + 1 : 0);
+            if (s.x1 > s.x2) {
+                s = o;
+            } else if (o.x1 <= o.x2) {
+                s = { std::min(s.x1, o.x1), std::max(s.x2, o.x2) };
+            }
+            row_span[i] = s;
+            row_cost[i] = STRIP_ROW_COST + pixels;
+            last_cost += row_cost[i];
+        }
+
+        // cut at the cumulative targets, the rounding of one strip does not shift the rest
+        uint64_t cost = 0;
+        uint32_t next_cut = 1;
+        uint32_t strip_first = 0;
+        for (uint32_t i = 0; i < rows; i++) {
+            cost += row_cost[i];
+            bool target_reached = cost * nr_of_strips >= last_cost * next_cut && i - strip_first + 1 >= min_rows;
+            if (!target_reached && i != rows - 1) {
+                continue;
+            }
+            // the columns the rows cover and their neighbours cover, the other fill paths round the vertices
+            // to the next row or column sometimes
+            Span strip_span = { square.x2, square.x1 };
+            uint32_t last = std::min(i + 1, rows - 1);
+            for (uint32_t k = strip_first ? strip_first - 1 : 0; k <= last; k++) {
+                if (row_span[k].x1 <= row_span[k].x2) {
+                    strip_span.x1 = std::min(strip_span.x1, row_span[k].x1);
+                    strip_span.x2 = std::max(strip_span.x2, row_span[k].x2);
+                }
+            }
+            // nothing to draw or to clear on these rows
+            if (strip_span.x1 <= strip_span.x2) {
+                strips.push_back({
+                    std::max(square.x1, strip_span.x1 - STRIP_X_MARGIN), square.y1 + (int32_t)strip_first,
+                    std::min(square.x2, strip_span.x2 + STRIP_X_MARGIN), square.y1 + (int32_t)i
+                });
+            }
+            while (cost * nr_of_strips >= last_cost * next_cut) {
+                next_cut++;
+            }
+            strip_first = i + 1;
+        }
+        return strips.size();
+    }
+}
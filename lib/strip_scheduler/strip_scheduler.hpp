@@ -0,0 +1,47 @@
+#if !defined(STRIP_SCHEDULER_H)
+#define STRIP_SCHEDULER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "base_geometry.hpp"
+#include "2D_rasterizer.hpp"
+
+namespace szilv {
+
+    // a row costs about as much as this many pixels: the root setup and the span search
+    const uint64_t STRIP_ROW_COST = 16;
+    // the columns of a strip are widened by this much, the fixed point and the SIMD paths may cover one
+    // more pixel at the edges than the span rasterizer the cost is estimated with
+    const int32_t STRIP_X_MARGIN = 2;
+
+    // Splits the area of a frame into strips of about the same cost instead of fixed row counts, so a strip
+    // across the wide middle of the triangle is not several times slower than one at a vertex. A row costs
+    // the pixels the current and the old triangle cover on it, the diff fill writes only those. The columns
+    // of every strip are narrowed to what its rows cover, strips neither triangle covers are left out.
+    // The strips go to the pool, the idle workers steal the rest of them.
+    class StripScheduler {
+        public:
+            // nr_of_strips: about 4 per worker leaves room for the stealing to even out the estimate
+            StripScheduler(uint32_t nr_of_strips = 32, uint32_t min_rows = 2);
+
+            void setNrOfStrips(uint32_t nr_of_strips) { this->nr_of_strips = nr_of_strips ? nr_of_strips : 1; }
+            uint32_t getNrOfStrips() { return nr_of_strips; }
+
+            // replaces strips with the strips of square, returns their number
+            virtual uint32_t split(SquareDefinition square, const Rasterizer2D & current, const Rasterizer2D & old,
+                    std::vector<SquareDefinition> & strips);
+            // the estimated cost of the last split, in pixels
+            uint64_t getLastCost() { return last_cost; }
+
+        private:
+            uint32_t nr_of_strips;
+            uint32_t min_rows;
+            uint64_t last_cost = 0;
+            // per row of the last square, kept to not allocate every frame
+            std::vector<uint64_t> row_cost;
+            std::vector<Span> row_span;
+    };
+}
+
+#endif /* !defined(STRIP_SCHEDULER_H) */
@@ -0,0 +1,243 @@
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+
+#include "thread_pool.hpp"
+
+namespace szilv {
+
+    // which pool and deque the current thread belongs to, submit() pushes there
+    static thread_local const ThreadPool * tl_pool = nullptr;
+    static thread_local uint32_t tl_worker_id = 0;
+
+    WorkStealingDeque::WorkStealingDeque(uint32_t capacity) : top(0), bottom(0) {
+        uint32_t cap = 2;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        mask = cap - 1;
+        buffer = std::vector<std::atomic<PoolTask *>>(cap);
+    }
+
+    /**
+     * owner only. Returns false when the deque is full
+     */
+    bool WorkStealingDeque::push(PoolTask * task) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t > mask) {
+            return false;
+        }
+        buffer[b & mask].store(task, std::memory_order_release);
+        // publishes the slot to the thieves
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * owner only, LIFO end
+     */
+    PoolTask * WorkStealingDeque::pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        PoolTask * task = buffer[b & mask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // the last one, race against the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                task = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    /**
+     * any thread, FIFO end. Returns nullptr when empty or when another thief won the race
+     */
+    PoolTask * WorkStealingDeque::steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        PoolTask * task = buffer[t & mask].load(std::memory_order_acquire);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return task;
+    }
+
+    ThreadPool::ThreadPool(uint32_t nr_of_workers, uint32_t queue_capacity)
+        : pending(0), steals(0), keep_running(true), active_workers(nr_of_workers), sleeping(0) {
+        this->nr_of_workers = nr_of_workers;
+        owner = std::this_thread::get_id();
+        // the last deque belongs to the submitting thread
+        for (uint32_t i = 0; i <= nr_of_workers; i++) {
+            deques.push_back(new WorkStealingDeque(queue_capacity));
+        }
+        tl_pool = this;
+        tl_worker_id = nr_of_workers;
+
+        // start worker threads
+        for (uint32_t i = 0; i < nr_of_workers; i++) {
+            threads.push_back(std::thread([this, i] { threadWorker(i); }));
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            keep_running = false;
+        }
+        cv_work.notify_all();
+        for (auto & thd : threads) {
+            thd.join();
+        }
+        for (auto deque : deques) {
+            delete deque;
+        }
+        if (tl_pool == this) {
+            tl_pool = nullptr;
+        }
+        std::clog << "ThreadPool destroyed, " << steals.load() << " steals" << std::endl;
+    }
+
+    /**
+     * Never blocks: the task goes to the deque of the calling thread. The lock is taken only while some
+     * workers sleep, so a batch submitted on a busy pool costs no lock per task.
+     */
+    void ThreadPool::submit(PoolTask * task) {
+        uint32_t id = tl_pool == this ? tl_worker_id : nr_of_workers;
+        // a second thread outside the pool would race the creating thread on the last deque
+        assert(id < nr_of_workers || std::this_thread::get_id() == owner);
+        pending.fetch_add(1, std::memory_order_acq_rel);
+
+        if (!deques[id]->push(task)) {
+            // the deque is full, run it right here
+            execute(task, id);
+            return;
+        }
+
+        // pairs with the fetch_add in threadWorker: either the worker going to sleep finds this task
+        // when it searches again, or it is counted in sleeping here and gets woken up
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed) > 0) {
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                wake_epoch++;
+            }
+            cv_work.notify_all();
+        }
+    }
+
+    void ThreadPool::setActiveWorkers(uint32_t n) {
+        n = std::min(std::max(n, 1U), nr_of_workers);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            active_workers.store(n, std::memory_order_relaxed);
+        }
+        // the woken up ones check whether they are still active
+        cv_work.notify_all();
+    }
+
+    /**
+     * Helps with the tasks of its own deque first, then steals from the workers, the same way an idle
+     * worker does. Creating thread only: a task waiting would count itself as pending and never return
+     */
+    void ThreadPool::wait() {
+        assert(std::this_thread::get_id() == owner);
+        uint32_t id = nr_of_workers;
+        while (pending.load(std::memory_order_acquire) > 0) {
+            PoolTask * task = findTask(id);
+            if (task) {
+                execute(task, id);
+                continue;
+            }
+            // the rest is running on the workers
+            std::unique_lock<std::mutex> lock(mtx);
+            cv_done.wait(lock, [this]() { return pending.load(std::memory_order_acquire) == 0; });
+        }
+    }
+
+    void ThreadPool::execute(PoolTask * task, uint32_t id) {
+        task->run(id);
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mtx);
+            cv_done.notify_all();
+        }
+    }
+
+    /**
+     * own deque first, then steal round-robin from the others including the submitter's
+     */
+    PoolTask * ThreadPool::findTask(uint32_t id) {
+        PoolTask * task = deques[id]->pop();
+        if (task) {
+            return task;
+        }
+        uint32_t nr_of_deques = deques.size();
+        for (uint32_t i = 1; i < nr_of_deques; i++) {
+            task = deques[(id + i) % nr_of_deques]->steal();
+            if (task) {
+                steals.fetch_add(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    void ThreadPool::threadWorker(uint32_t id) {
+        tl_pool = this;
+        tl_worker_id = id;
+        uint32_t idle = 0;
+
+        while (keep_running.load(std::memory_order_relaxed)) {
+            if (id >= active_workers.load(std::memory_order_relaxed)) {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv_work.wait(lock, [this, id]() {
+                    return !keep_running || id < active_workers.load(std::memory_order_relaxed);
+                });
+                continue;
+            }
+            PoolTask * task = findTask(id);
+            if (task) {
+                execute(task, id);
+                idle = 0;
+                continue;
+            }
+            // tasks still running elsewhere may spawn more, spin a little before going to sleep
+            if (pending.load(std::memory_order_acquire) > 0 && ++idle < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            idle = 0;
+
+            uint64_t seen_epoch;
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                seen_epoch = wake_epoch;
+            }
+            sleeping.fetch_add(1, std::memory_order_seq_cst);
+            // a task pushed before the fetch_add above did not see this worker sleeping, look once more
+            task = findTask(id);
+            if (task) {
+                sleeping.fetch_sub(1, std::memory_order_relaxed);
+                execute(task, id);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mtx);
+            cv_work.wait(lock, [this, seen_epoch]() { return !keep_running || wake_epoch != seen_epoch; });
+            sleeping.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#if !defined(THREAD_POOL_H)
+#define THREAD_POOL_H
+
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace szilv {
+
+    // a unit of work, owned by the submitter until ThreadPool::wait returns
+    class PoolTask {
+        public:
+            virtual ~PoolTask() {}
+            // worker_id is 0..nr_of_workers-1 for the pool threads and nr_of_workers for the submitting thread
+            virtual void run(uint32_t worker_id) = 0;
+    };
+
+    // Chase-Lev deque with a fixed capacity (power of two). Only the owner thread pushes and pops
+    // at the bottom, any thread steals from the top.
+    class WorkStealingDeque {
+        public:
+            WorkStealingDeque(uint32_t capacity);
+
+            bool push(PoolTask * task);
+            PoolTask * pop();
+            PoolTask * steal();
+
+        private:
+            // top and bottom on their own cache lines, thieves and the owner do not false share
+            char pad0[64];
+            std::atomic<int64_t> top;
+            char pad1[64];
+            std::atomic<int64_t> bottom;
+            char pad2[64];
+            int64_t mask;
+            std::vector<std::atomic<PoolTask *>> buffer;
+    };
+
+    // Work-stealing pool with one deque per worker plus one for the thread that created the pool.
+    // That thread submits a whole frame without blocking and waits once at the end of the frame;
+    // tasks submitted from inside a task go to the deque of the worker running it. The creating thread
+    // is the only submitter from outside the pool, no other thread may submit or wait.
+    class ThreadPool {
+        public:
+            ThreadPool(uint32_t nr_of_workers, uint32_t queue_capacity = 4096);
+            ~ThreadPool();
+
+            virtual void submit(PoolTask * task);
+            // frame latch: returns when every task submitted so far has finished. The waiting thread
+            // runs tasks from its own deque and steals from the workers meanwhile. Only the creating
+            // thread waits, never a pool task: the running task is still pending
+            virtual void wait();
+            uint32_t getNrOfWorkers() { return nr_of_workers; }
+            // parks the workers from n on (1..nr_of_workers), they do not take tasks until raised again.
+            // Tasks already in their deques are stolen by the others
+            virtual void setActiveWorkers(uint32_t n);
+            uint32_t getActiveWorkers() { return active_workers.load(std::memory_order_relaxed); }
+            uint64_t getSteals() { return steals.load(std::memory_order_relaxed); }
+
+        private:
+            uint32_t nr_of_workers;
+            // the thread that created the pool, it owns the last deque
+            std::thread::id owner;
+            std::vector<WorkStealingDeque *> deques;
+            std::vector<std::thread> threads;
+
+            std::atomic<uint32_t> pending;
+            std::atomic<uint64_t> steals;
+            std::atomic<bool> keep_running;
+            std::atomic<uint32_t> active_workers;
+            // workers about to sleep or sleeping on cv_work, submit() wakes them only when it is not 0
+            std::atomic<uint32_t> sleeping;
+
+            // sleeping: workers wait for a new batch, the submitter for the end of the frame
+            std::mutex mtx;
+            std::condition_variable cv_work;
+            std::condition_variable cv_done;
+            uint64_t wake_epoch = 0;
+
+            PoolTask * findTask(uint32_t id);
+            void execute(PoolTask * task, uint32_t id);
+            void threadWorker(uint32_t id);
+    };
+}
+
+#endif /* !defined(THREAD_POOL_H) */
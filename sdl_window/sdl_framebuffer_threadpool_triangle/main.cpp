@@ -9,35 +9,46 @@
 #include <cmath>
 #include <thread>
 #include <algorithm>
+#include <memory>
+#include <string>
 
 #include "cli_args_szilv.hpp"
 #include "base_geometry.hpp"
 #include "2D_triangle.hpp"
+#include "2D_rasterizer.hpp"
+#include "frame_pacer.hpp"
+#include "profiling.hpp"
+#include "trace.hpp"
 
 
-static uint64_t loop_count = 0;
-static auto prev_time = std::chrono::steady_clock::now();
-static uint64_t prev_loop_count = 0;
+// the TBB worker count follows the load when the frames are paced
+static uint32_t max_parallelism = 1;
+static std::unique_ptr<oneapi::tbb::global_control> parallelism_control;
 
 /**
- *
+ * more workers when the frames overrun, fewer when they have headroom
  */
-uint32_t fps_counter_callback(void* userdata, SDL_TimerID timerID, uint32_t interval) {
-    auto now = std::chrono::steady_clock::now();
-
-    auto elapsed = now - prev_time;
-    uint64_t frames = loop_count - prev_loop_count;
-    // Convert elapsed time to a double representing seconds
-    double seconds_passed = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
-    double fps = frames / seconds_passed;
-    std::clog << "FPS: " << std::round(fps) << "\r" << std::flush;
-
-    prev_loop_count = loop_count;
-    prev_time = now;
-
-    return interval; // Return the same interval to stay on a loop
+void pacer_hint(szilv::PacerHint hint, void * user_data) {
+    uint32_t current = parallelism_control
+        ? oneapi::tbb::global_control::active_value(oneapi::tbb::global_control::max_allowed_parallelism)
+        : max_parallelism;
+    uint32_t next = hint == szilv::PACER_OVERRUN ? current + 1 : current - 1;
+    next = std::min(std::max(next, 1U), max_parallelism);
+    parallelism_control.reset(new oneapi::tbb::global_control(
+                oneapi::tbb::global_control::max_allowed_parallelism, next));
+    std::clog << std::endl << (hint == szilv::PACER_OVERRUN ? "frames overrun" : "frames have headroom") << ", "
+        << next << " threads" << std::endl;
 }
 
+// one frame from the geometry to the present. With --pipeline the next one is prepared while the
+// parallel_for of the previous one still runs
+struct Frame {
+    szilv::Triangle2D triangle = szilv::Triangle2D({0, 0, 0}, {0, 0, 0}, {0, 0, 0});
+    szilv::Rasterizer2D rasterizer;
+    szilv::FixedRasterizer2D fixed_rasterizer;
+    szilv::SquareDefinition square = {0, 0, -1, -1};
+};
+
 /**
  *
  */
@@ -95,6 +106,14 @@ int main(int argc, char *argv[]) {
             "Theoretically it supports all the platforms whatever SDL3 supports.\nAuthor Szilveszter Zsigmond.");
     try {
         cliArgs.addOptionInteger("s,triangle-side-size", "The size of the triangle side.", default_triangle_side_size);
+        cliArgs.addOptionBoolean("fixed-point", "Rasterize with vertices snapped to 28.4 fixed point and integer edge functions", false);
+        cliArgs.addOptionBoolean("pipeline", "Rotate the triangle and set up the rasterizer of the next frame while the "
+                "TBB workers draw the current one, at most one frame more latency", false);
+        cliArgs.addOptionBoolean("pace", "Limit the frame rate to the refresh rate of the display or to --target-fps, "
+                "sleeping between the frames. The number of workers follows the load", false);
+        cliArgs.addOptionInteger("target-fps", "The frame rate of --pace, 0: the refresh rate of the display", 0);
+        cliArgs.addOptionString("trace", "Record the TBB tasks and the presents as a Chrome trace "
+                "(chrome://tracing, ui.perfetto.dev), written to this file on exit", "");
         cliArgs.addOptionHelp("h,help", "Prints this help message.");
         cliArgs.parseArguments(argc, argv);
     } catch (szcl::CliArgsSzilvException& e) {
@@ -106,6 +125,8 @@ int main(int argc, char *argv[]) {
         return 0;
     }
     const uint32_t trg_side = cliArgs.has("s") ? cliArgs.getOptionInteger("s") : 400;
+    const bool fixed_point = cliArgs.has("fixed-point") && cliArgs.getOptionBoolean("fixed-point");
+    const bool pipeline = cliArgs.has("pipeline") && cliArgs.getOptionBoolean("pipeline");
 
     // -----------------------
     // SDL
@@ -128,8 +149,20 @@ int main(int argc, char *argv[]) {
             w, h
             );
 
-    uint32_t fps_report_interval = 1000; // ms
-    SDL_TimerID timerID = SDL_AddTimer(fps_report_interval, fps_counter_callback, nullptr); 
+    szilv::FpsMeter fps_meter;
+    std::string trace_path = cliArgs.has("trace") ? cliArgs.getOptionString("trace") : "";
+    if (!trace_path.empty()) {
+        szilv::Trace::start();
+        szilv::Trace::setThreadName("render");
+    }
+
+    std::unique_ptr<szilv::FramePacer> pacer;
+    if (cliArgs.has("pace") && cliArgs.getOptionBoolean("pace")) {
+        uint32_t target_fps = cliArgs.has("target-fps") ? cliArgs.getOptionInteger("target-fps") : 0;
+        const SDL_DisplayMode * mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window));
+        double refresh = mode && mode->refresh_rate > 0 ? mode->refresh_rate : 60.0;
+        pacer.reset(new szilv::FramePacer(target_fps ? target_fps : refresh));
+    }
 
     // -----------------------
     // Triangle
@@ -153,11 +186,77 @@ int main(int argc, char *argv[]) {
     // old
     szilv::Triangle2D triangle2 = szilv::Triangle2D({0,0}, {0,0}, {0,0});
     szilv::Triangle2D * old_triangle = &triangle2;
-
+    szilv::Rasterizer2D old_rasterizer(old_triangle->getPrimitive());
+    szilv::FixedRasterizer2D old_fixed_rasterizer(old_triangle->getPrimitive());
+    // prepared by the geometry, and running but not presented yet
+    Frame frames[2];
+    Frame * drawing = nullptr;
 
     auto prev_timestamp = std::chrono::steady_clock::now();
     // Adding static_partitioner mimics your manual "divide by N threads" approach
     oneapi::tbb::static_partitioner partitioner;
+    if (pacer) {
+        max_parallelism = oneapi::tbb::info::default_concurrency();
+        pacer->setHintCallback(pacer_hint, nullptr);
+    }
+    // runs the parallel_for of the frame in flight, the render thread goes on with the next geometry
+    oneapi::tbb::task_group frame_group;
+
+    // locks the texture and starts drawing frame
+    auto submit_frame = [&](Frame * frame) {
+        void *pixels;
+        int32_t pitch;
+        SDL_LockTexture(tex, NULL, &pixels, &pitch);
+        // Treat the buffer as bytes for the row calculation
+        uint8_t* base_ptr = static_cast<uint8_t*>(pixels);
+
+        frame_group.run([&, frame, base_ptr, pitch]() {
+            const szilv::SquareDefinition & square = frame->square;
+            auto range = oneapi::tbb::blocked_range2d<int>(square.y1 , square.y2, square.x1, square.x2);
+            oneapi::tbb::parallel_for(
+                    range,
+                    [&](const oneapi::tbb::blocked_range2d<int>& r) {
+                        szilv::TraceScope trace("tbb task", "tbb", "y1", r.rows().begin());
+                        for (int y = r.rows().begin(); y <= r.rows().end(); y++) {
+                            // Find the start of the current row
+                            uint32_t* row = reinterpret_cast<uint32_t*>(base_ptr + (y * pitch));
+
+                            // only the new span and what is left of the old one are written
+                            if (fixed_point) {
+                                frame->fixed_rasterizer.fillRowDiff(row, y, old_fixed_rasterizer, r.cols().begin(), r.cols().end(),
+                                        0x4285f4,       // triangle color
+                                        0x0);           // background color
+                            } else {
+                                frame->rasterizer.fillRowDiff(row, y, old_rasterizer, r.cols().begin(), r.cols().end(),
+                                        0x4285f4,       // triangle color
+                                        0x0);           // background color
+                            }
+                        }
+                    },
+                    partitioner
+            );
+        });
+        drawing = frame;
+    };
+
+    // waits for the frame in flight and shows it
+    auto finish_frame = [&]() {
+        if (!drawing) {
+            return;
+        }
+        frame_group.wait();
+        // update the old Triangle
+        old_triangle->setPrimitive(drawing->triangle.getPrimitive());
+        old_rasterizer.setPrimitive(drawing->triangle.getPrimitive());
+        old_fixed_rasterizer.setPrimitive(drawing->triangle.getPrimitive());
+        drawing = nullptr;
+
+        szilv::TraceScope trace("present", "sdl");
+        SDL_UnlockTexture(tex);
+        SDL_RenderTexture(ren, tex, NULL, NULL);
+        SDL_RenderPresent(ren);
+    };
+
     bool running = true;
     while (running) {
         // first, handle all the pending events
@@ -171,6 +270,8 @@ int main(int argc, char *argv[]) {
 
                 case SDL_EVENT_WINDOW_RESIZED: 
                     {
+                        // the frame in flight still draws into the texture
+                        finish_frame();
                         SDL_GetWindowSize(window, &w, &h);
                         std::clog << "Window size: " << w << ", " << h << std::endl << std::flush;
                         // destroy previous texture 
@@ -185,64 +286,60 @@ int main(int argc, char *argv[]) {
                         // check if the triangle sides should be recalculated
                         calculateTheTrianglePositionAndSize(new_triangle, w, h, trg_side);
                         calculateTheTrianglePositionAndSize(old_triangle, w, h, trg_side);
+                        old_rasterizer.setPrimitive(old_triangle->getPrimitive());
+                        old_fixed_rasterizer.setPrimitive(old_triangle->getPrimitive());
                     }
                     break;
             }
         }
 
         // then draw something
+        if (pacer) {
+            pacer->beginFrame();
+        }
         auto now = std::chrono::steady_clock::now();
         auto elapsed = now - prev_timestamp;
         double angle = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
 
-        void *pixels;
-        int32_t pitch;
-        SDL_LockTexture(tex, NULL, &pixels, &pitch);
-
-        // Treat the buffer as bytes for the row calculation
-        uint8_t* base_ptr = static_cast<uint8_t*>(pixels);
-        uint32_t stride = pitch / 4;
-
         // rotate the Triangle
         new_triangle->rotateAroundTheCenter(angle);
+        Frame * frame = drawing == &frames[0] ? &frames[1] : &frames[0];
+        frame->triangle.setPrimitive(new_triangle->getPrimitive());
+
+        // the frame in flight draws into the same texture first
+        frame->square = defineTheSquareContainingTheTriangles(&frame->triangle, drawing ? &drawing->triangle : old_triangle);
+        if (fixed_point) {
+            frame->fixed_rasterizer.setPrimitive(frame->triangle.getPrimitive());
+        } else {
+            frame->rasterizer.setPrimitive(frame->triangle.getPrimitive());
+        }
 
-        szilv::SquareDefinition squareCoordinates = defineTheSquareContainingTheTriangles(new_triangle, old_triangle);
-
-        auto isInside = [new_triangle](szilv::Vertex point) -> bool {
-            return new_triangle->pointInTriangle(point);
-        };
-
-        auto range = oneapi::tbb::blocked_range2d<int>(squareCoordinates.y1 , squareCoordinates.y2, squareCoordinates.x1, squareCoordinates.x2);
-        oneapi::tbb::parallel_for(
-                range,
-                [&](const oneapi::tbb::blocked_range2d<int>& r) {
-                    for (int y = r.rows().begin(); y <= r.rows().end(); y++) {
-                        // Find the start of the current row
-                        int32_t* row = reinterpret_cast<int32_t*>(base_ptr + (y * pitch));
-
-                        for (int x = r.cols().begin(); x <= r.cols().end(); x++) {
-                            szilv::Vertex point = {(double)x, (double)y, 0.0};
-                            row[x] = isInside(point) 
-                                ? 0x4285f4      // triangle color
-                                : 0x0;          // background color
-                        }
-                    }
-                },
-                partitioner
-        );
-
-        // update the old Triangle
-        old_triangle->setPrimitive(new_triangle->getPrimitive());
-
-        SDL_UnlockTexture(tex);
-        SDL_RenderTexture(ren, tex, NULL, NULL);
-        SDL_RenderPresent(ren);
+        // without --pipeline the frame in flight is the one just prepared. The next one starts after the
+        // present, when the old rasterizers are updated and the texture is locked again
+        if (!pipeline) {
+            submit_frame(frame);
+        }
+        finish_frame();
+        if (pipeline) {
+            submit_frame(frame);
+        }
+        if (pacer) {
+            pacer->waitForNextFrame();
+        }
 
-        loop_count++;
+        fps_meter.frame();
+        if (fps_meter.update(szilv::FrameProfiler::nowNanos())) {
+            std::clog << "FPS: " << std::round(fps_meter.getFps()) << "\r" << std::flush;
+        }
         prev_timestamp = now;
     }
 
-    SDL_RemoveTimer(timerID);
+    finish_frame();
+    if (!trace_path.empty()) {
+        // parallel_for has returned, the TBB workers are idle
+        szilv::Trace::dumpJson(trace_path.c_str());
+    }
+    parallelism_control.reset();
     SDL_Quit();
     return 0;
 }
@@ -7,34 +7,66 @@
 #include <cmath>
 #include <thread>
 #include <algorithm>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <string>
 
 #include "cli_args_szilv.hpp"
 #include "base_geometry.hpp"
 #include "2D_triangle.hpp"
 #include "2D_line_drawer.hpp"
+#include "thread_pool.hpp"
+#include "2D_rasterizer.hpp"
+#include "frame_pacer.hpp"
+#include "strip_scheduler.hpp"
+#include "profiling.hpp"
+#include "trace.hpp"
+#include "perf_counters.hpp"
+
+
+static szilv::FrameProfiler * profiler = nullptr;
+static std::vector<szilv::perf_worker> * perf_workers = nullptr;
+
+// a slice that charges its time and its hardware counters to its worker
+class ProfiledDrawTask : public szilv::DrawTask {
+    public:
+        ProfiledDrawTask(szilv::DrawWork work) : DrawTask(work),
+            pixels((uint64_t)(work.squareDefinition.x2 - work.squareDefinition.x1 + 1)
+                    * (work.squareDefinition.y2 - work.squareDefinition.y1 + 1)) {}
+        void run(uint32_t worker_id) override {
+            szilv::WorkerTimer timer(profiler, worker_id);
+            szilv::PerfScope perf(perf_workers ? &(*perf_workers)[worker_id] : nullptr, pixels);
+            DrawTask::run(worker_id);
+        }
 
-
-static uint64_t loop_count = 0;
-static auto prev_time = std::chrono::steady_clock::now();
-static uint64_t prev_loop_count = 0;
+    private:
+        uint64_t pixels;
+};
+
+// one frame from the geometry to the present. With --pipeline the next one is prepared while the
+// workers still draw the previous one
+struct Frame {
+    szilv::Triangle2D triangle = szilv::Triangle2D({0, 0, 0}, {0, 0, 0}, {0, 0, 0});
+    szilv::Rasterizer2D rasterizer;
+    std::vector<szilv::SquareDefinition> strips;
+};
+
+static void profile_phase(szilv::FramePhase phase) {
+    if (profiler) {
+        profiler->phase(phase);
+    }
+}
 
 /**
- *
+ * more workers when the frames overrun, fewer when they have headroom
  */
-uint32_t fps_counter_callback(void* userdata, SDL_TimerID timerID, uint32_t interval) {
-    auto now = std::chrono::steady_clock::now();
-
-    auto elapsed = now - prev_time;
-    uint64_t frames = loop_count - prev_loop_count;
-    // Convert elapsed time to a double representing seconds
-    double seconds_passed = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
-    double fps = frames / seconds_passed;
-    std::clog << "FPS: " << std::round(fps) << "\r" << std::flush;
-
-    prev_loop_count = loop_count;
-    prev_time = now;
-
-    return interval; // Return the same interval to stay on a loop
+void pacer_hint(szilv::PacerHint hint, void * user_data) {
+    szilv::ThreadPool * pool = (szilv::ThreadPool *) user_data;
+    uint32_t active = pool->getActiveWorkers();
+    pool->setActiveWorkers(hint == szilv::PACER_OVERRUN ? active + 1 : active - 1);
+    std::clog << std::endl << (hint == szilv::PACER_OVERRUN ? "frames overrun" : "frames have headroom") << ", "
+        << pool->getActiveWorkers() << " workers" << std::endl;
 }
 
 /**
@@ -98,6 +130,19 @@ int main(int argc, char *argv[]) {
         cliArgs.addOptionInteger("s,triangle-side-size", "The size of the triangle side.", default_triangle_side_size);
         cliArgs.addOptionInteger("w,parallel-draw-workers", "The number of parallel draw workers. Default is the number of available CPUs.", default_cpus);
         cliArgs.addOptionInteger("buffer-slice", "The size of buffer slice we are pushing to one draw worker once.", default_slices);
+        cliArgs.addOptionBoolean("adaptive-slices", "Instead of --buffer-slice rows, split the frame into strips of equal "
+                "estimated cost from the spans of the triangles, about 4 per worker", false);
+        cliArgs.addOptionBoolean("pipeline", "Rotate the triangle and split the next frame into strips while the workers "
+                "draw the current one, at most one frame more latency. The profile has no per worker times then", false);
+        cliArgs.addOptionBoolean("pace", "Limit the frame rate to the refresh rate of the display or to --target-fps, "
+                "sleeping between the frames. The number of workers follows the load", false);
+        cliArgs.addOptionInteger("target-fps", "The frame rate of --pace, 0: the refresh rate of the display", 0);
+        cliArgs.addOptionString("profile", "Record the phase timings of every frame and write their percentiles as JSON "
+                "to this file on exit and on SIGUSR1", "");
+        cliArgs.addOptionString("trace", "Record the slices of the workers and the presents as a Chrome trace "
+                "(chrome://tracing, ui.perfetto.dev), written to this file on exit", "");
+        cliArgs.addOptionBoolean("perf-counters", "Count cycles, instructions, cache and branch misses of every worker "
+                "in the slices with perf_event_open, IPC and misses per pixel are printed on exit", false);
         cliArgs.addOptionHelp("h,help", "Prints this help message.");
         cliArgs.parseArguments(argc, argv);
     } catch (szcl::CliArgsSzilvException& e) {
@@ -110,6 +155,8 @@ int main(int argc, char *argv[]) {
     }
     uint32_t nr_of_draw_workers = cliArgs.has("w") ? cliArgs.getOptionInteger("w") : default_cpus;
     uint32_t buffer_slice = cliArgs.has("buffer-slice") ? cliArgs.getOptionInteger("buffer-slice") : 10;
+    const bool adaptive_slices = cliArgs.has("adaptive-slices") && cliArgs.getOptionBoolean("adaptive-slices");
+    const bool pipeline = cliArgs.has("pipeline") && cliArgs.getOptionBoolean("pipeline");
     const uint32_t trg_side = cliArgs.has("s") ? cliArgs.getOptionInteger("s") : 400;
 
     // -----------------------
@@ -133,13 +180,39 @@ int main(int argc, char *argv[]) {
             w, h
             );
 
-    uint32_t fps_report_interval = 1000; // ms
-    SDL_TimerID timerID = SDL_AddTimer(fps_report_interval, fps_counter_callback, nullptr); 
+    szilv::FpsMeter fps_meter;
+    std::unique_ptr<szilv::FrameProfiler> frame_profiler;
+    std::string profile_path = cliArgs.has("profile") ? cliArgs.getOptionString("profile") : "";
+    if (!profile_path.empty()) {
+        // the thread waiting for the pool helps as worker nr_of_draw_workers. The slices of a pipelined
+        // frame run across endFrame, their worker times would land in the next frame
+        frame_profiler.reset(new szilv::FrameProfiler(pipeline ? 0 : nr_of_draw_workers + 1));
+        frame_profiler->setDumpPath(profile_path.c_str());
+        szilv::FrameProfiler::installSignalHandler();
+        profiler = frame_profiler.get();
+    }
+    std::unique_ptr<std::vector<szilv::perf_worker>> worker_counters;
+    if (cliArgs.has("perf-counters") && cliArgs.getOptionBoolean("perf-counters")) {
+        worker_counters.reset(new std::vector<szilv::perf_worker>(nr_of_draw_workers + 1));
+        perf_workers = worker_counters.get();
+    }
+    std::string trace_path = cliArgs.has("trace") ? cliArgs.getOptionString("trace") : "";
+    if (!trace_path.empty()) {
+        szilv::Trace::start();
+        szilv::Trace::setThreadName("render");
+    }
+
+    std::unique_ptr<szilv::FramePacer> pacer;
+    if (cliArgs.has("pace") && cliArgs.getOptionBoolean("pace")) {
+        uint32_t target_fps = cliArgs.has("target-fps") ? cliArgs.getOptionInteger("target-fps") : 0;
+        const SDL_DisplayMode * mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window));
+        double refresh = mode && mode->refresh_rate > 0 ? mode->refresh_rate : 60.0;
+        pacer.reset(new szilv::FramePacer(target_fps ? target_fps : refresh));
+    }
 
     // -----------------------
     // Triangle
     // -----------------------
-    std::vector<szilv::LineDrawer2D *> workers;
     // current
     // initial position and orientation of the triangle
     double trg_offset_x = 0;
@@ -159,16 +232,73 @@ int main(int argc, char *argv[]) {
     // old
     szilv::Triangle2D triangle2 = szilv::Triangle2D({0,0}, {0,0}, {0,0});
     szilv::Triangle2D * old_triangle = &triangle2;
+    szilv::Rasterizer2D old_rasterizer(old_triangle->getPrimitive());
+    szilv::StripScheduler strip_scheduler;
+    // prepared by the geometry, and submitted but not presented yet
+    Frame frames[2];
+    Frame * drawing = nullptr;
 
     // start worker threads
-    for ( uint32_t i = 0; i < nr_of_draw_workers; i++) {
-        workers.push_back(new szilv::LineDrawer2D(i, 0, 0));
+    szilv::ThreadPool pool(nr_of_draw_workers);
+    if (pacer) {
+        pacer->setHintCallback(pacer_hint, &pool);
     }
+    // the slices of the frame in flight, they live until pool.wait() returns
+    std::deque<ProfiledDrawTask> frame_tasks;
+    int32_t pitch = 0;
+
+    // locks the texture and hands the strips of frame to the workers
+    auto submit_frame = [&](Frame * frame) {
+        profile_phase(szilv::PHASE_RASTER);
+        void *pixels;
+        SDL_LockTexture(tex, NULL, &pixels, &pitch);
+        // Treat the buffer as bytes for the row calculation
+        uint8_t* base_ptr = static_cast<uint8_t*>(pixels);
+        uint32_t stride = pitch / 4;
+        for (auto & square_slice : frame->strips) {
+            szilv::DrawWork work = {
+                0x4285f4,      // triangle color
+                0x0,    // background color
+                (void*)&frame->triangle, szilv::SHAPE_TRIANGLE,
+                square_slice,
+                base_ptr,
+                (uint32_t)pitch,
+                stride, (uint32_t)h,
+                &frame->rasterizer, &old_rasterizer
+            };
+            frame_tasks.emplace_back(work);
+            pool.submit(&frame_tasks.back());
+        }
+        drawing = frame;
+    };
+
+    // waits for the frame in flight once and shows it
+    auto finish_frame = [&]() {
+        if (!drawing) {
+            return;
+        }
+        profile_phase(szilv::PHASE_SYNC_WAIT);
+        pool.wait();
+        frame_tasks.clear();
+        // update the old Triangle
+        old_triangle->setPrimitive(drawing->triangle.getPrimitive());
+        old_rasterizer.setPrimitive(drawing->triangle.getPrimitive());
+        drawing = nullptr;
+
+        profile_phase(szilv::PHASE_PRESENT);
+        szilv::TraceScope trace("present", "sdl");
+        SDL_UnlockTexture(tex);
+        SDL_RenderTexture(ren, tex, NULL, NULL);
+        SDL_RenderPresent(ren);
+    };
 
 
     auto prev_timestamp = std::chrono::steady_clock::now();
     int32_t running = 1;
     while (running) {
+        if (profiler) {
+            profiler->beginFrame();
+        }
         // first, handle all the pending events
         while(SDL_PollEvent(&e)) {
             switch (e.type) {
@@ -180,6 +310,8 @@ int main(int argc, char *argv[]) {
 
                 case SDL_EVENT_WINDOW_RESIZED: 
                     {
+                        // the frame in flight still draws into the texture
+                        finish_frame();
                         SDL_GetWindowSize(window, &w, &h);
                         std::clog << "Window size: " << w << ", " << h << std::endl << std::flush;
                         // destroy previous texture 
@@ -194,75 +326,89 @@ int main(int argc, char *argv[]) {
                         // check if the triangle sides should be recalculated
                         calculateTheTrianglePositionAndSize(new_triangle, w, h, trg_side);
                         calculateTheTrianglePositionAndSize(old_triangle, w, h, trg_side);
+                        old_rasterizer.setPrimitive(old_triangle->getPrimitive());
                     }
                     break;
             }
         }
 
         // then draw something
+        profile_phase(szilv::PHASE_GEOMETRY);
+        if (pacer) {
+            pacer->beginFrame();
+        }
         auto now = std::chrono::steady_clock::now();
         auto elapsed = now - prev_timestamp;
         double angle = std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count();
 
-        void *pixels;
-        int32_t pitch;
-        SDL_LockTexture(tex, NULL, &pixels, &pitch);
-        // Treat the buffer as bytes for the row calculation
-        uint8_t* base_ptr = static_cast<uint8_t*>(pixels);
-
         // rotate the Triangle
         new_triangle->rotateAroundTheCenter(angle);
-
-        szilv::SquareDefinition squareCoordinates = defineTheSquareContainingTheTriangles(new_triangle, old_triangle);
-        auto isInside = [new_triangle](szilv::Vertex point) -> bool {
-            return new_triangle->pointInTriangle(point);
-        };
-
-        // distribute slices of the big 2D square, the triangle is inside, between worker threads
-        uint32_t slice = 0;
-        uint32_t stride = pitch / 4;
-        for (int32_t y=squareCoordinates.y1; y <= squareCoordinates.y2; y+=buffer_slice) {
-            szilv::SquareDefinition square_slice = {
-                squareCoordinates.x1, y, 
-                squareCoordinates.x2, std::min(y + (int32_t)buffer_slice, squareCoordinates.y2)
-            }; 
-
-            szilv::DrawWork work = {
-                0x4285f4,      // triangle color
-                0x0,    // background color
-                (void*)new_triangle, isInside,
-                square_slice,
-                base_ptr,
-                (uint32_t)pitch,
-                stride, (uint32_t)h
-            };
-            auto worker = workers[slice % nr_of_draw_workers];
-            worker->addWorkBlocking(work);
-            slice++;
+        Frame * frame = drawing == &frames[0] ? &frames[1] : &frames[0];
+        frame->triangle.setPrimitive(new_triangle->getPrimitive());
+
+        // the frame in flight draws into the same texture first, the slices run after it
+        szilv::Triangle2D * before = drawing ? &drawing->triangle : old_triangle;
+        const szilv::Rasterizer2D & before_rasterizer = drawing ? drawing->rasterizer : old_rasterizer;
+        szilv::SquareDefinition squareCoordinates = defineTheSquareContainingTheTriangles(&frame->triangle, before);
+        frame->rasterizer.setPrimitive(frame->triangle.getPrimitive());
+
+        // slices of the big 2D square, the triangle is inside, the workers steal them from each other
+        frame->strips.clear();
+        if (adaptive_slices) {
+            // the waiting thread draws too
+            strip_scheduler.setNrOfStrips((pool.getActiveWorkers() + 1) * 4);
+            strip_scheduler.split(squareCoordinates, frame->rasterizer, before_rasterizer, frame->strips);
+        } else {
+            for (int32_t y=squareCoordinates.y1; y <= squareCoordinates.y2; y+=buffer_slice) {
+                frame->strips.push_back({
+                    squareCoordinates.x1, y, 
+                    squareCoordinates.x2, std::min(y + (int32_t)buffer_slice, squareCoordinates.y2)
+                });
+            }
         }
 
-        // update the old Triangle
-        old_triangle->setPrimitive(new_triangle->getPrimitive());
-
-        // sync worker threads
-        for ( uint32_t i = 0; i < nr_of_draw_workers; i++) {
-            workers[i]->blockMainThreadUntilTheQueueIsNotEmpty();
+        // without --pipeline the frame in flight is the one just prepared. The next one is submitted after
+        // the present, when the old rasterizer is updated and the texture is locked again
+        if (!pipeline) {
+            submit_frame(frame);
+        }
+        finish_frame();
+        if (pipeline) {
+            submit_frame(frame);
+        }
+        if (profiler) {
+            // the pacing sleep is not part of the frame
+            profiler->endFrame();
+        }
+        if (pacer) {
+            pacer->waitForNextFrame();
         }
 
-        SDL_UnlockTexture(tex);
-        SDL_RenderTexture(ren, tex, NULL, NULL);
-        SDL_RenderPresent(ren);
-
-        loop_count++;
+        fps_meter.frame();
+        if (fps_meter.update(szilv::FrameProfiler::nowNanos())) {
+            std::clog << "FPS: " << std::round(fps_meter.getFps());
+            if (profiler) {
+                // the busiest worker over the mean, in the last frame
+                std::clog << ", imbalance " << profiler->getLastImbalance();
+            }
+            std::clog << "\r" << std::flush;
+        }
         prev_timestamp = now;
     }
 
-    // join worker threads
-    while (workers.size()) {
-        delete workers.back(); // the destructor calls the thread join
-        workers.pop_back();
+    finish_frame();
+    if (profiler) {
+        frame_profiler->dumpJson(profile_path.c_str());
+        profiler = nullptr;
+    }
+    if (perf_workers) {
+        szilv::writePerfReport(std::clog, *perf_workers);
+        perf_workers = nullptr;
+    }
+    if (!trace_path.empty()) {
+        // pool.wait() has returned, the workers are idle
+        szilv::Trace::dumpJson(trace_path.c_str());
     }
-    SDL_RemoveTimer(timerID);
     SDL_Quit();
     return 0;
 }